@@ -7,6 +7,9 @@
 // Chau Ying Kot, Teo Ferrari, Gildas Houlmann
 // ASD1_B_J
 
+#ifndef ABR_CPP
+#define ABR_CPP
+
 #include <cstdlib>
 #include <iostream>
 #include <sstream>
@@ -15,494 +18,3820 @@
 #include <queue>
 #include <cassert>
 #include <stdexcept>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include <new>
+#include <cstddef>
+#include <iterator>
+#include <algorithm>
+#include <thread>
+#include <exception>
+#include <utility>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ABR_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
-template<typename T>
-class BinarySearchTree {
+// Précharge en cache la ligne contenant p, sans effet si non supporté
+#if defined(__GNUC__)
+#define ABR_PREFETCH(p) __builtin_prefetch(p)
+#else
+#define ABR_PREFETCH(p) ((void) 0)
+#endif
+
+/**
+ *  @brief Politique de traçage par défaut : ne fait rien.
+ *
+ *  Un traceur est notifié par l'arbre à chaque création et destruction de
+ *  noeud. Les méthodes vides sont inlinées et disparaissent à la compilation.
+ */
+struct NoTrace {
+    template<typename K>
+    void created(const void*, const K&) noexcept {}
+
+    template<typename K>
+    void destroyed(const void*, const K&) noexcept {}
+};
+
+/**
+ *  @brief Traceur écrivant (Ccle) / (Dcle) sur cout à chaque création et
+ *  destruction de noeud.
+ *
+ *  @remark chaque événement coûte une écriture synchronisée sur le flux,
+ *  à réserver au debug.
+ */
+struct CoutTrace {
+    template<typename K>
+    void created(const void*, const K& key) {
+        cout << "(C" << key << ") ";
+    }
+
+    template<typename K>
+    void destroyed(const void*, const K& key) {
+        cout << "(D" << key << ") ";
+    }
+};
+
+/**
+ *  @brief Traceur enregistrant les événements dans un tampon circulaire
+ *  sans verrou, à relire plus tard avec dump().
+ *
+ *  Seuls les Capacity derniers événements sont conservés. Chaque case est
+ *  protégée par un numéro de séquence (impair pendant l'écriture), ce qui
+ *  permet à dump() de lire le tampon pendant que d'autres threads écrivent.
+ *
+ *  @tparam T        type des clés, doit être trivialement copiable
+ *  @tparam Capacity nombre de cases, doit être une puissance de 2
+ */
+template<typename T, size_t Capacity = 4096>
+class RingBufferTrace {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "RingBufferTrace demande des cles trivialement copiables");
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity doit etre une puissance de 2");
+
 public:
+    enum class Event : unsigned char { Created, Destroyed };
 
-    using value_type = T;
-    using reference = T&;
-    using const_reference = const T&;
+    RingBufferTrace() : _slots(new Slot[Capacity]) {}
 
-private:
-    /**
-     *  @brief Noeud de l'arbre.
-     *
-     * contient une cle et les liens vers les sous-arbres droit et gauche.
-     */
-    struct Node {
-        const value_type key; // clé non modifiable
-        Node* right;          // sous arbre avec des cles plus grandes
-        Node* left;           // sous arbre avec des cles plus petites
-        size_t nbElements;    // nombre de noeuds dans le sous arbre dont
-        // ce noeud est la racine
+    template<typename K>
+    void created(const void* node, const K& key) noexcept {
+        record(Event::Created, node, key);
+    }
 
-        Node(const_reference key)  // seul constructeur disponible. key est obligatoire
-                : key(key), right(nullptr), left(nullptr), nbElements(1) {
-            cout << "(C" << key << ") ";
-        }
+    template<typename K>
+    void destroyed(const void* node, const K& key) noexcept {
+        record(Event::Destroyed, node, key);
+    }
+
+    //
+    // @brief nombre total d'événements enregistrés depuis la création,
+    //        y compris ceux déjà écrasés
+    //
+    // @remark O(1)
+    uint64_t recorded() const noexcept {
+        return _head.load(std::memory_order_acquire);
+    }
 
-        ~Node()               // destructeur
-        {
-            cout << "(D" << key << ") ";
+    //
+    // @brief Ecrit les événements encore présents dans le tampon, du plus
+    //        ancien au plus récent, au format (Ccle) / (Dcle)
+    //
+    // Les cases en cours d'écriture par un autre thread sont ignorées.
+    //
+    // @remark O(Capacity)
+    void dump(ostream& os = cout) const {
+        uint64_t head = recorded();
+        uint64_t first = head > Capacity ? head - Capacity : 0;
+        for (uint64_t i = first; i < head; ++i) {
+            const Slot& s = _slots[i & (Capacity - 1)];
+            uint64_t seq = s.seq.load(std::memory_order_acquire);
+            if (seq != 2 * i + 2) continue; // case ecrasee ou en cours
+            Event e = s.event.load(std::memory_order_relaxed);
+            T key = s.key.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.seq.load(std::memory_order_relaxed) != seq) continue;
+            os << (e == Event::Created ? "(C" : "(D") << key << ") ";
         }
+    }
 
-        Node() = delete;             // pas de construction par défaut
-        Node(const Node&) = delete;  // pas de construction par copie
-        Node(Node&&) = delete;       // pas de construction par déplacement
+private:
+    struct Slot {
+        std::atomic<uint64_t> seq{0};     // 2i+1 en ecriture, 2i+2 une fois ecrit
+        std::atomic<Event> event{Event::Created};
+        std::atomic<const void*> node{nullptr};
+        std::atomic<T> key{};
     };
 
-    /**
-     *  @brief  Racine de l'arbre. nullptr si l'arbre est vide
-     */
-    Node* _root;
+    void record(Event e, const void* node, const T& key) noexcept {
+        uint64_t i = _head.fetch_add(1, std::memory_order_relaxed);
+        Slot& s = _slots[i & (Capacity - 1)];
+        s.seq.store(2 * i + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s.event.store(e, std::memory_order_relaxed);
+        s.node.store(node, std::memory_order_relaxed);
+        s.key.store(key, std::memory_order_relaxed);
+        s.seq.store(2 * i + 2, std::memory_order_release);
+    }
 
-public:
-    /**
-     *  @brief Constructeur par défaut. Construit un arbre vide
-     *
-     *  @remark O(1)
-     */
-    BinarySearchTree() : _root(nullptr) {
-        /* ... */
+    std::atomic<uint64_t> _head{0};
+    std::unique_ptr<Slot[]> _slots;
+};
+
+/**
+ *  @brief Opérations instrumentées par une politique de statistiques
+ */
+enum class StatOp : unsigned char { Insert, Lookup, Erase };
+
+/**
+ *  @brief Cas de suppression d'un noeud : feuille, un seul fils, ou deux
+ *  fils (le noeud est alors remplacé par son successeur)
+ */
+enum class EraseCase : unsigned char { Leaf, OneChild, TwoChildren };
+
+/**
+ *  @brief Instantané des statistiques et de la forme d'un arbre, produit
+ *  par BinarySearchTree::stats()
+ *
+ *  La profondeur d'une descente est le nombre de noeuds visités ; la
+ *  dernière case de l'histogramme cumule les descentes plus profondes.
+ */
+struct TreeStatsSnapshot {
+    static constexpr size_t Ops = 3;
+    static constexpr size_t Cases = 3;
+    static constexpr size_t Depths = 64;
+
+    uint64_t operations[Ops] = {};   // par StatOp
+    uint64_t comparisons[Ops] = {};  // comparaisons de clés, par StatOp
+    uint64_t erased[Cases] = {};     // par EraseCase
+    uint64_t depths[Depths] = {};    // histogramme des profondeurs
+    size_t size = 0;                 // noeuds : clés distinctes en multiensemble
+    size_t height = 0;               // 0 pour un arbre vide
+    size_t optimalHeight = 0;        // floor(log2(size)) + 1
+
+    //
+    // @brief nombre moyen de comparaisons par opération, 0 sans opération
+    //
+    double comparisonsPerOperation(StatOp op) const noexcept {
+        uint64_t n = operations[size_t(op)];
+        return n == 0 ? 0 : double(comparisons[size_t(op)]) / double(n);
     }
 
-    /**
-     *  @brief Constucteur de copie. Crée un arbre temporaire et copie l'arbre
-     *  dans la valeur temp et si tout ce passe bien, on swap les deux racine
-     *
-     *  @param other le BinarySearchTree à copier
-     *
-     *  @remark O(n)
-     *
-     */
-    BinarySearchTree(BinarySearchTree& other) : _root(nullptr) {
-        BinarySearchTree temp;
-        temp.copyTree(other._root);
-        std::swap(temp._root, _root);
+    //
+    // @brief hauteur rapportée à la hauteur optimale, 1 pour un arbre
+    //        parfaitement équilibré (ou vide)
+    //
+    double heightRatio() const noexcept {
+        return optimalHeight == 0 ? 1 : double(height) / double(optimalHeight);
     }
 
+    //
+    // @brief Ecrit l'instantané, une mesure par ligne
+    //
+    void writeText(ostream& os) const {
+        os << "size " << size << "\nheight " << height << "\noptimal_height "
+           << optimalHeight << "\nheight_ratio " << heightRatio() << "\n";
+        for (size_t op = 0; op < Ops; ++op) {
+            os << opName(op) << " " << operations[op] << " comparisons/op "
+               << comparisonsPerOperation(StatOp(op)) << "\n";
+        }
+        for (size_t c = 0; c < Cases; ++c) {
+            os << "erase_" << caseName(c) << " " << erased[c] << "\n";
+        }
+        for (size_t d = 0; d < Depths; ++d) {
+            if (depths[d] != 0) os << "depth " << d << " " << depths[d] << "\n";
+        }
+    }
 
-private :
-    /**
-     * @brief Copie l'arbre l'arbre courant depuis le noeud donée
-     *
-     * @param node la racine de l'arbre où on commence à copier
-     *
-     * @remark O(n)
-     */
-    void copyTree(const Node* node) {
-        if (node != nullptr) {
-            insert(node->key);
-            copyTree(node->left);
-            copyTree(node->right);
+    //
+    // @brief Ecrit l'instantané en un objet JSON ; l'histogramme est un
+    //        tableau indexé par la profondeur, sans les zéros finaux
+    //
+    void writeJson(ostream& os) const {
+        os << "{\"size\":" << size << ",\"height\":" << height
+           << ",\"optimal_height\":" << optimalHeight
+           << ",\"height_ratio\":" << heightRatio();
+        for (size_t op = 0; op < Ops; ++op) {
+            os << ",\"" << opName(op) << "\":{\"count\":" << operations[op]
+               << ",\"comparisons\":" << comparisons[op] << "}";
         }
+        os << ",\"erase_cases\":{";
+        for (size_t c = 0; c < Cases; ++c) {
+            os << (c ? "," : "") << "\"" << caseName(c) << "\":" << erased[c];
+        }
+        size_t used = Depths;
+        while (used > 0 && depths[used - 1] == 0) --used;
+        os << "},\"depths\":[";
+        for (size_t d = 0; d < used; ++d) os << (d ? "," : "") << depths[d];
+        os << "]}";
+    }
+
+private:
+    static const char* opName(size_t op) noexcept {
+        static const char* const names[Ops] = {"insert", "lookup", "erase"};
+        return names[op];
+    }
+
+    static const char* caseName(size_t c) noexcept {
+        static const char* const names[Cases] = {"leaf", "one_child", "two_children"};
+        return names[c];
     }
+};
+
+/**
+ *  @brief Politique de statistiques par défaut : ne mesure rien.
+ *
+ *  Les méthodes vides sont inlinées et les compteurs de l'arbre qui les
+ *  alimentent disparaissent à la compilation.
+ */
+struct NoStats {
+    static constexpr bool enabled = false;
+
+    void descent(StatOp, size_t, size_t) noexcept {}
+
+    void erased(EraseCase) noexcept {}
+
+    void fill(TreeStatsSnapshot&) const noexcept {}
 
+    void reset() noexcept {}
+};
+
+/**
+ *  @brief Statistiques d'utilisation : nombre d'opérations, comparaisons,
+ *  histogramme des profondeurs de descente et cas de suppression.
+ *
+ *  Les compteurs sont incrémentés par une lecture et une écriture
+ *  relâchées, sans instruction atomique : des lectures concurrentes de
+ *  l'arbre (contains) peuvent perdre quelques incréments, mais sans course
+ *  de données.
+ */
+class TreeStats {
 public:
-    /**
-     *  @brief Opérateur d'affectation par copie. Crée un arbre temporaire et copie
-     *  l'arbre dans la valeur temp et si tout ce passe bien, on swap les
-     *  deux racine et retourne un pointer sur l'arbre
-     *
-     *  @param other le BinarySearchTree à copier
-     *
-     *  @remark O(n)
-     *
-     */
-    BinarySearchTree& operator=(const BinarySearchTree& other) {
-        BinarySearchTree temp;
-        temp.copyTree(other._root);
-        std::swap(temp._root, _root);
-        return *this;
+    static constexpr bool enabled = true;
+
+    TreeStats() noexcept = default;
+
+    TreeStats(const TreeStats&) = delete;
+    TreeStats& operator=(const TreeStats&) = delete;
+
+    //
+    // @brief une descente de l'opération op a visité depth noeuds et fait
+    //        comparisons comparaisons de clés
+    //
+    void descent(StatOp op, size_t depth, size_t comparisons) noexcept {
+        bump(_operations[size_t(op)], 1);
+        bump(_comparisons[size_t(op)], comparisons);
+        bump(_depths[std::min(depth, TreeStatsSnapshot::Depths - 1)], 1);
     }
 
-    /**
-     *  @brief Echange le contenu avec un autre BST
-     *  Swap les deux racines
-     *
-     *  @param other le BST avec lequel on echange le contenu
-     *
-     *  @remark O(1)
-     *
-     */
-    void swap(BinarySearchTree& other) noexcept {
-        std::swap(_root, other._root);
+    void erased(EraseCase c) noexcept {
+        bump(_erased[size_t(c)], 1);
     }
 
-    /**
-     *  @brief constructeur de copie par déplacement, deplace les ressources de
-     *  l'arbre passée en paramètre vers notre arbre courant.
-     *  La racine de l'arbre passée en paramètre pointera sur un nullptr
-     *
-     *  @param other le BST dont on vole le contenu
-     *
-     *  @remark O(1)
-     *
-     */
-    BinarySearchTree(BinarySearchTree&& other) noexcept : _root(move(other._root)) {
-        other._root = nullptr;
+    //
+    // @brief recopie les compteurs dans s
+    //
+    void fill(TreeStatsSnapshot& s) const noexcept {
+        copy(_operations, s.operations);
+        copy(_comparisons, s.comparisons);
+        copy(_erased, s.erased);
+        copy(_depths, s.depths);
     }
 
-    /**
-     *  @brief Opérateur d'affectation par déplacement, deplace les ressources de
-     *  l'arbre passée en paramètre vers notre arbre courant.
-     *  La racine de l'arbre passée en paramètre pointera sur un nullptr
-     *  Il retourne un pointer sur l'arbre courant
-     *
-     *  @param other le BST dont on vole le contenu
-     *
-     *  @remark O(1)
-     *
-     */
-    BinarySearchTree& operator=(BinarySearchTree&& other) noexcept {
-        _root = std::move(other._root);
-        other._root = nullptr;
-        return *this;
+    void reset() noexcept {
+        for (auto& c : _operations) c.store(0, std::memory_order_relaxed);
+        for (auto& c : _comparisons) c.store(0, std::memory_order_relaxed);
+        for (auto& c : _erased) c.store(0, std::memory_order_relaxed);
+        for (auto& c : _depths) c.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static void bump(std::atomic<uint64_t>& c, uint64_t d) noexcept {
+        c.store(c.load(std::memory_order_relaxed) + d, std::memory_order_relaxed);
+    }
+
+    template<size_t N>
+    static void copy(const std::atomic<uint64_t> (&from)[N], uint64_t (&to)[N]) noexcept {
+        for (size_t i = 0; i < N; ++i) to[i] = from[i].load(std::memory_order_relaxed);
     }
 
+    std::atomic<uint64_t> _operations[TreeStatsSnapshot::Ops] = {};
+    std::atomic<uint64_t> _comparisons[TreeStatsSnapshot::Ops] = {};
+    std::atomic<uint64_t> _erased[TreeStatsSnapshot::Cases] = {};
+    std::atomic<uint64_t> _depths[TreeStatsSnapshot::Depths] = {};
+};
+
+/**
+ *  @brief Politique d'équilibrage par défaut : aucun rééquilibrage.
+ *
+ *  L'arbre ne fait que des insertions / suppressions naïves, seul balance()
+ *  permet de le rééquilibrer.
+ */
+struct NoBalance {
+    static constexpr bool rebalances = false;
+    static constexpr bool rebuilds = false;
+    static constexpr bool watchesHeight = false;
+
     //
-    // @brief Destructeur
+    // @brief vrai si un sous-arbre de taille heavy est trop lourd par rapport
+    //        à son frère de taille light
     //
-    // Ne pas modifier mais écrire la fonction
-    // récursive privée deleteSubTree(Node*)
+    bool overweight(size_t, size_t) const noexcept {
+        return false;
+    }
+
     //
-    // @remark O(n)
-    ~BinarySearchTree() {
-        deleteSubTree(_root);
+    // @brief vrai si une rotation simple suffit à corriger le déséquilibre,
+    //        inner et outer étant les tailles des petits-enfants du côté lourd
+    //
+    bool singleRotation(size_t, size_t) const noexcept {
+        return true;
     }
+};
+
+/**
+ *  @brief Equilibrage par poids (arbre BB[alpha]).
+ *
+ *  Utilise uniquement les nbElements déjà maintenus par chaque noeud :
+ *  après chaque insertion ou suppression, les noeuds du chemin sont
+ *  corrigés par une rotation simple ou double dès qu'un sous-arbre pèse
+ *  plus de Delta fois son frère. La hauteur reste en O(log(n)).
+ *
+ *  Les paramètres (Delta, Gamma) = (3, 2) sont ceux de Hirai et Yamamoto,
+ *  pour lesquels une seule correction par noeud suffit.
+ */
+struct WeightBalanced {
+    static constexpr bool rebalances = true;
+    static constexpr bool rebuilds = false;
+    static constexpr bool watchesHeight = false;
+    static constexpr size_t Delta = 3;
+    static constexpr size_t Gamma = 2;
+
+    bool overweight(size_t heavy, size_t light) const noexcept {
+        return heavy + 1 > Delta * (light + 1);
+    }
+
+    bool singleRotation(size_t inner, size_t outer) const noexcept {
+        return inner + 1 < Gamma * (outer + 1);
+    }
+};
+
+/**
+ *  @brief Equilibrage par reconstruction partielle (arbre bouc émissaire).
+ *
+ *  Après chaque insertion ou suppression, les nbElements du chemin sont
+ *  mis à jour et le plus haut noeud dont un sous-arbre pèse plus de Delta
+ *  fois son frère est reconstruit par linéarisation et arborisation. Aucune
+ *  rotation : un sous-arbre reconstruit de taille s ne redevient déséquilibré
+ *  qu'après O(s) modifications, le coût est donc de O(log(n)) amorti.
+ */
+struct Scapegoat {
+    static constexpr bool rebalances = true;
+    static constexpr bool rebuilds = true;
+    static constexpr bool watchesHeight = false;
+    static constexpr size_t Delta = 3;
+
+    bool overweight(size_t heavy, size_t light) const noexcept {
+        return heavy + 1 > Delta * (light + 1);
+    }
+
+    bool singleRotation(size_t, size_t) const noexcept {
+        return true;
+    }
+};
+
+/**
+ *  @brief Rééquilibrage global automatique, sans correction locale.
+ *
+ *  Les insertions et suppressions restent naïves, comme avec NoBalance,
+ *  mais balance() est appelé dès que la hauteur dépasse
+ *  factor * log2(n + 1), ou après mutationLimit modifications.
+ *
+ *  La hauteur n'est jamais recalculée : une feuille n'est créée que par
+ *  insertion et une suppression ne rapproche les noeuds que de la racine,
+ *  la plus grande profondeur d'insertion depuis le dernier balance() est
+ *  donc un majorant de la hauteur, tenu en O(1).
+ *
+ *  En mode différé, l'arbre ne rééquilibre jamais de lui-même ; l'appelant
+ *  appelle maintain() au moment voulu.
+ *
+ *  @warning Avec les paramètres par défaut, une suite d'insertions triées
+ *  faites par insert() relance balance(), en O(n), toutes les
+ *  (factor - 1) log2(n) insertions : charger n clés triées coûte alors
+ *  O(n^2 / log(n)). Un chargement en masse passe donc par insert_batch,
+ *  par le constructeur par plage ou par assign, qui accrochent les clés
+ *  triées en sous-arbres équilibrés et ne testent la hauteur qu'une fois.
+ *
+ *  amortization non nul fait attendre à un rééquilibrage dû à la hauteur
+ *  n / amortization modifications depuis le précédent : balance() ne coûte
+ *  plus que O(amortization) amorti par modification, mais la hauteur peut
+ *  atteindre n / amortization entre deux rééquilibrages, et chaque descente
+ *  avec elle. Ce délai ne rend donc pas insert() linéaire sur des clés
+ *  triées ; il sert quand les déséquilibres sont rares et que le coût de
+ *  balance() doit rester borné. maintain() ne tient pas compte de ce délai.
+ */
+struct AutoRebalance {
+    static constexpr bool rebalances = false;
+    static constexpr bool rebuilds = false;
+    static constexpr bool watchesHeight = true;
+
+    double factor = 4;        // une hauteur aléatoire vaut environ 3 log2(n)
+    size_t mutationLimit = 0; // 0 : pas de rééquilibrage périodique
+    size_t amortization = 0;  // 0 : pas de délai
+    bool deferred = false;    // vrai : seulement via maintain()
+
+    AutoRebalance() noexcept = default;
 
-private:
     //
-    // @brief Fonction détruisant (delete) un sous arbre
+    // @param factor        hauteur tolérée, en multiple de log2(n + 1)
+    // @param mutationLimit nombre de modifications entre deux balance(),
+    //                      0 pour aucun
+    // @param deferred      vrai pour ne rééquilibrer que via maintain()
+    // @param amortization  0 pour rééquilibrer dès que la hauteur dépasse
+    //                      la borne ; a > 0 pour attendre n / a
+    //                      modifications, soit O(a) amorti par modification
     //
-    // @param r la racine du sous arbre à détruire.
-    //          peut éventuellement valoir nullptr
+    explicit AutoRebalance(double factor, size_t mutationLimit = 0,
+                           bool deferred = false, size_t amortization = 0) noexcept
+            : factor(factor), mutationLimit(mutationLimit),
+              amortization(amortization), deferred(deferred) {}
+
+    bool overweight(size_t, size_t) const noexcept {
+        return false;
+    }
+
+    bool singleRotation(size_t, size_t) const noexcept {
+        return true;
+    }
+
     //
-    // @remark O(taille de l'arbre avec r comme racine)
-    static void deleteSubTree(Node* r) noexcept {
-        if (r != nullptr) { // Condition d'arrêt pour la résursvité
-            if (r->left != nullptr) {
-                deleteSubTree(r->left);
-            }
-            if (r->right != nullptr) {
-                deleteSubTree(r->right);
-            }
+    // @brief un noeud vient d'être placé à la profondeur depth (la racine
+    //        est à la profondeur 1)
+    //
+    void descended(size_t depth) noexcept {
+        _heightBound = std::max(_heightBound, depth);
+    }
 
-        }
-        delete (r);
+    void mutated(size_t count) noexcept {
+        _mutations += count;
     }
 
-public:
     //
-    // @brief Insertion d'une cle dans l'arbre
+    // @brief vrai si un arbre de n noeuds doit être rééquilibré
     //
-    // @param key la clé à insérer.
+    // @param strict vrai pour ignorer le délai d'amortissement
     //
-    // Ne pas modifier mais écrire la fonction
-    // récursive privée insert(Node*&,const_reference)
+    bool due(size_t n, bool strict) const noexcept {
+        if (mutationLimit != 0 && _mutations >= mutationLimit) return true;
+        if (double(_heightBound) <= factor * std::log2(double(n) + 1)) return false;
+        return strict || amortization == 0 || _mutations * amortization >= n;
+    }
+
     //
-    // @remark O(log(n))
-    void insert(const_reference key) {
-        insert(_root, key);
+    // @brief l'arbre vient d'être rééquilibré et sa hauteur vaut height
+    //
+    void balanced(size_t height) noexcept {
+        _heightBound = height;
+        _mutations = 0;
+    }
+
+    size_t heightBound() const noexcept {
+        return _heightBound;
+    }
+
+    size_t mutations() const noexcept {
+        return _mutations;
     }
 
 private:
+    size_t _heightBound = 0;
+    size_t _mutations = 0;
+};
+
+/**
+ *  @brief Allocateur par défaut : chaque noeud est alloué et libéré
+ *  individuellement avec new / delete.
+ */
+struct NewAllocator {
     //
-    // @brief Insertion d'une cle dans un sous-arbre
-    //
-    // @param r la racine du sous-arbre dans lequel
-    //          insérer la cle.
-    // @param key la clé à insérer.
+    // @brief vrai si release() libère d'un coup tous les noeuds alloués
     //
-    // @return vrai si la cle est inseree. faux si elle etait deja presente.
+    static constexpr bool bulkRelease = false;
+
+    template<typename N>
+    void* allocate() {
+        return ::operator new(sizeof(N));
+    }
+
+    template<typename N>
+    void deallocate(void* p) noexcept {
+        ::operator delete(p);
+    }
+
     //
-    // Si la cle est deja presente, cette fonction ne fait rien.
-    // x peut éventuellement valoir nullptr en entrée.
-    // la fonction peut modifier x, reçu par référence, si nécessaire
+    // @brief annonce l'allocation prochaine de n noeuds
     //
-    // @remark O(log(n))
-    static bool insert(Node*& r, const_reference key) {
-        if (r == nullptr) { // Si la racine est nul on peut inserer directement
-            r = new Node{key};
-            r->nbElements = 1;
-            return true;
-        } else if (key < r->key) { // Si la clé est plus petite que la clé du
-            // noeaud inserer à gauche
-            bool inserted = insert(r->left, key);
-            if (inserted) {
-                if (r->right == nullptr) {
-                    r->nbElements = (r->left->nbElements + 1);
-                } else if (r->left == nullptr) {
-                    r->nbElements = (r->right->nbElements + 1);
-                } else {
-                    r->nbElements = r->right->nbElements + r->left->nbElements + 1;
-                }
-            }
-            return inserted;
-        } else if (key > r->key) { // Si la clé est plus grande que la clé du
-            // noeaud inserer à droite
-            bool inserted = insert(r->right, key);
-            if (inserted) {
-                if (r->right == nullptr) {
-                    r->nbElements = (r->left->nbElements + 1);
-                } else if (r->left == nullptr) {
-                    r->nbElements = (r->right->nbElements + 1);
-                } else {
-                    r->nbElements = r->right->nbElements + r->left->nbElements + 1;
-                }
-            }
-            return inserted;
-        } else {// La clé est déja présent
-            return false;
+    template<typename N>
+    void reserve(size_t) {}
+
+    void release() noexcept {}
+};
+
+/**
+ *  @brief Allocateur par blocs (slabs) de NodesPerSlab noeuds.
+ *
+ *  Les noeuds sont découpés séquentiellement dans le bloc courant, ce qui
+ *  les garde contigus en mémoire. Un noeud libéré est chaîné dans une
+ *  liste libre intrusive (stockée dans le noeud lui-même) et réutilisé par
+ *  l'allocation suivante. release() rend tous les blocs en O(nb blocs),
+ *  sans parcourir les noeuds.
+ *
+ *  @tparam NodesPerSlab nombre de noeuds par bloc
+ */
+template<size_t NodesPerSlab = 4096>
+class SlabAllocator {
+    static_assert(NodesPerSlab != 0, "NodesPerSlab doit etre positif");
+
+public:
+    static constexpr bool bulkRelease = true;
+
+    SlabAllocator() noexcept = default;
+
+    SlabAllocator(const SlabAllocator&) = delete;
+    SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+    SlabAllocator(SlabAllocator&& other) noexcept {
+        swap(other);
+    }
+
+    SlabAllocator& operator=(SlabAllocator&& other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~SlabAllocator() {
+        release();
+    }
+
+    void swap(SlabAllocator& other) noexcept {
+        std::swap(_slabs, other._slabs);
+        std::swap(_free, other._free);
+        std::swap(_freeCount, other._freeCount);
+        std::swap(_cursor, other._cursor);
+        std::swap(_end, other._end);
+    }
+
+    template<typename N>
+    void* allocate() {
+        static_assert(sizeof(N) >= sizeof(FreeBlock), "noeud trop petit");
+        static_assert(alignof(N) <= alignof(std::max_align_t),
+                      "alignement non supporte");
+        if (_free != nullptr) { // réutilise un noeud libéré
+            FreeBlock* b = _free;
+            _free = b->next;
+            --_freeCount;
+            return b;
         }
+        if (_cursor == _end) { // bloc courant plein
+            newSlab(NodesPerSlab * sizeof(N));
+        }
+        void* p = _cursor;
+        _cursor += sizeof(N);
+        return p;
     }
 
-public:
     //
-    // @brief Recherche d'une cle.
+    // @brief garantit n allocations sans nouvelle allocation système
     //
-    // @param key la cle a rechercher
+    // Les noeuds libérés et la fin du bloc courant sont comptés d'abord ;
+    // s'ils ne suffisent pas, un bloc assez grand pour le reste remplace
+    // le bloc courant. allocate() puisant d'abord dans la liste libre, les
+    // n noeuds ne sont contigus que si elle est vide.
     //
-    // @return vrai si la cle trouvee, faux sinon.
+    // @remark O(1)
+    template<typename N>
+    void reserve(size_t n) {
+        if (n <= _freeCount) return;
+        const size_t missing = n - _freeCount;
+        if (size_t(_end - _cursor) / sizeof(N) < missing) {
+            newSlab(std::max(missing, NodesPerSlab) * sizeof(N));
+        }
+    }
+
+    template<typename N>
+    void deallocate(void* p) noexcept {
+        FreeBlock* b = static_cast<FreeBlock*>(p);
+        b->next = _free;
+        _free = b;
+        ++_freeCount;
+    }
+
     //
-    // Ne pas modifier mais écrire la fonction
-    // récursive privée contains(Node*,const_reference)
+    // @brief libère tous les blocs. Les noeuds ne sont pas détruits, ce qui
+    //        n'est valable que si leur destructeur est trivial.
     //
-    // @remark O(log(n))
-    bool contains(const_reference key) const noexcept {
-        return contains(_root, key);
+    // @remark O(nb blocs)
+    void release() noexcept {
+        for (char* slab : _slabs) ::operator delete(slab);
+        _slabs.clear();
+        _free = nullptr;
+        _freeCount = 0;
+        _cursor = _end = nullptr;
     }
 
 private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    void newSlab(size_t bytes) {
+        _slabs.reserve(_slabs.size() + 1);
+        char* slab = static_cast<char*>(::operator new(bytes));
+        _slabs.push_back(slab);
+        _cursor = slab;
+        _end = slab + bytes;
+    }
+
+    std::vector<char*> _slabs;     // blocs alloués
+    FreeBlock* _free = nullptr;    // liste des noeuds libérés
+    size_t _freeCount = 0;         // longueur de _free
+    char* _cursor = nullptr;       // prochain noeud libre du bloc courant
+    char* _end = nullptr;          // fin du bloc courant
+};
+
+/**
+ *  @brief Fichier projeté en mémoire en lecture seule.
+ *
+ *  Les pages ne sont lues sur le disque qu'au premier accès et restent
+ *  partagées avec le cache du système. Sans mmap, le fichier est lu en
+ *  entier dans un tampon.
+ */
+class MappedFile {
+public:
     //
-    // @brief Recherche d'une cle dans un sous-arbre
+    // @exception std::runtime_error si le fichier ne peut pas être lu
     //
-    // @param key la cle a rechercher
-    // @param r   la racine du sous-arbre
+    explicit MappedFile(const std::string& path) : _data(nullptr), _size(0) {
+#if defined(ABR_HAS_MMAP)
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Impossible d'ouvrir " + path);
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Impossible de lire " + path);
+        }
+        _size = size_t(st.st_size);
+        if (_size != 0) {
+            void* p = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("Impossible de projeter " + path);
+            }
+            _data = static_cast<const unsigned char*>(p);
+        }
+        ::close(fd);
+#else
+        std::ifstream in(path, std::ios::binary);
+        if (!in) throw std::runtime_error("Impossible d'ouvrir " + path);
+        _copy.assign(std::istreambuf_iterator<char>(in),
+                     std::istreambuf_iterator<char>());
+        _data = reinterpret_cast<const unsigned char*>(_copy.data());
+        _size = _copy.size();
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+#if defined(ABR_HAS_MMAP)
+        if (_data != nullptr) ::munmap(const_cast<unsigned char*>(_data), _size);
+#endif
+    }
+
+    const unsigned char* data() const noexcept {
+        return _data;
+    }
+
+    size_t size() const noexcept {
+        return _size;
+    }
+
+private:
+    const unsigned char* _data;
+    size_t _size;
+#if !defined(ABR_HAS_MMAP)
+    std::vector<char> _copy;
+#endif
+};
+
+/**
+ *  @brief En-tête des fichiers écrits par BinarySearchTree::save.
+ *
+ *  Le fichier contient l'en-tête, les count clés triées à partir de
+ *  l'octet Size, puis éventuellement les mêmes clés dans la disposition
+ *  d'Eytzinger de FrozenTree à partir de l'octet layout. Les deux tableaux
+ *  commencent sur un multiple de Size octets, ce qui permet de les lire
+ *  directement dans le fichier projeté.
+ */
+struct TreeFileHeader {
+    static constexpr size_t Size = 64;
+    static constexpr uint32_t Order = 0x01020304;
+
+    char magic[4];    // "ABRK"
+    uint32_t order;   // Order, écrit dans l'ordre des octets de la machine
+    uint64_t keySize; // sizeof(T)
+    uint64_t count;   // nombre de clés
+    uint64_t layout;  // début de la disposition d'Eytzinger, 0 si absente
+
+    //
+    // @brief début du premier tableau placé après n octets
+    //
+    static uint64_t align(uint64_t n) noexcept {
+        return (n + Size - 1) / Size * Size;
+    }
+
+    //
+    // @brief Lit et vérifie l'en-tête d'un fichier de clés de keySize octets
+    //
+    // @exception std::runtime_error si le fichier n'a pas été écrit par
+    //            save pour ce type de clés sur une machine compatible
+    //
+    static TreeFileHeader read(const MappedFile& file, size_t keySize) {
+        TreeFileHeader h;
+        if (file.size() < Size)
+            throw std::runtime_error("Fichier d'arbre invalide");
+        std::memcpy(&h, file.data(), sizeof(h));
+        uint64_t room = (file.size() - Size) / keySize;
+        if (std::memcmp(h.magic, "ABRK", 4) != 0 || h.order != Order ||
+            h.keySize != keySize || h.count > room)
+            throw std::runtime_error("Fichier d'arbre invalide");
+        uint64_t bytes = h.count * keySize;
+        if (h.layout != 0 && (h.layout % Size != 0 || h.layout < Size + bytes ||
+                              h.layout > file.size() ||
+                              file.size() - h.layout < bytes))
+            throw std::runtime_error("Fichier d'arbre invalide");
+        return h;
+    }
+};
+
+static_assert(sizeof(TreeFileHeader) <= TreeFileHeader::Size,
+              "l'en-tête doit tenir avant les clés");
+
+/**
+ *  @brief Instantané immuable des clés d'un arbre, rangées dans un tableau
+ *  selon la disposition d'Eytzinger (parcours en largeur d'un arbre
+ *  complet : les fils de la case k sont les cases 2k et 2k + 1).
+ *
+ *  Les premiers niveaux, visités par toutes les recherches, occupent
+ *  quelques lignes de cache contiguës. La descente est sans branchement et
+ *  précharge les noeuds quatre niveaux plus bas. La taille de chaque
+ *  sous-arbre se calcule à partir de n et de la position, ce qui donne
+ *  rank et nth_element sans compteur stocké.
+ *
+ *  Les positions sont numérotées à partir de 1 ; la case k est _keys[k - 1].
+ *  Les cases appartiennent à l'instantané ou, après BinarySearchTree::map,
+ *  à un fichier projeté ; les copies d'un instantané les partagent.
+ */
+template<typename T>
+class FrozenTree {
+public:
+    using value_type = T;
+    using const_reference = const T&;
+
+    //
+    // @brief Instantané vide
+    //
+    FrozenTree() = default;
+
+    //
+    // @brief Construit l'instantané à partir de n clés triées par ordre
+    //        strictement croissant
+    //
+    // @param first début de la séquence triée
+    // @param n     nombre de clés
+    //
+    // @remark O(n)
+    template<typename InputIt>
+    FrozenTree(InputIt first, size_t n) : _size(n) {
+        auto keys = std::make_shared<std::vector<value_type>>(n);
+        for (size_t k = firstSym(n); k != 0; k = nextSym(k, n), ++first) {
+            (*keys)[k - 1] = *first;
+        }
+        _keys = keys->data();
+        _storage = std::move(keys);
+    }
+
+    //
+    // @brief Instantané sur n cases déjà rangées dans la disposition
+    //        d'Eytzinger, sans copie
+    //
+    // @param storage propriétaire des cases, gardé en vie par l'instantané
+    // @param keys    première case
+    // @param n       nombre de cases
+    //
+    // @remark O(1)
+    FrozenTree(std::shared_ptr<const void> storage, const value_type* keys,
+               size_t n) noexcept
+            : _storage(std::move(storage)), _keys(keys), _size(n) {}
+
+    size_t size() const noexcept {
+        return _size;
+    }
+
+    //
+    // @brief les cases dans la disposition d'Eytzinger
+    //
+    const value_type* data() const noexcept {
+        return _keys;
+    }
+
+    //
+    // @brief Recherche d'une cle
+    //
+    // @remark O(log(n))
+    bool contains(const_reference key) const noexcept {
+        size_t k = lowerBound(key);
+        return k != 0 && !(key < at(k));
+    }
+
+    //
+    // @brief position d'une cle dans l'ordre croissant
+    //
+    // @return la position entre 0 et size()-1, size_t(-1) si la cle est absente
+    //
+    // @remark O(log(n))
+    size_t rank(const_reference key) const noexcept {
+        size_t k = lowerBound(key);
+        if (k == 0 || key < at(k)) return size_t(-1);
+        return position(k);
+    }
+
+    //
+    // @brief nombre de cles strictement plus petites que key
+    //
+    // @remark O(log(n))
+    size_t rank_lower(const_reference key) const noexcept {
+        size_t k = lowerBound(key);
+        return k == 0 ? size() : position(k);
+    }
+
+    //
+    // @brief cle en position n par ordre croissant
+    //
+    // La descente ne fait que de l'arithmétique sur les tailles de
+    // sous-arbres : seule la case finale est lue.
+    //
+    // @exception std::logic_error si n >= size()
+    //
+    // @remark O(log(n))
+    const_reference nth_element(size_t n) const {
+        if (n >= size())
+            throw std::logic_error("La position est plus "
+                                   "grand que le nombre "
+                                   "d'éléments");
+        size_t k = 1;
+        for (;;) {
+            size_t s = subtreeSize(2 * k);
+            if (n < s) {
+                k = 2 * k;
+            } else if (n > s) {
+                n -= s + 1;
+                k = 2 * k + 1;
+            } else {
+                return at(k);
+            }
+        }
+    }
+
+private:
+    const_reference at(size_t k) const noexcept {
+        return _keys[k - 1];
+    }
+
+    //
+    // @brief case de la plus petite cle qui n'est pas plus petite que key,
+    //        0 si toutes les cles sont plus petites
+    //
+    // La descente ajoute un bit par niveau (1 si on part à droite). Une
+    // fois sortie du tableau, on retire les derniers départs à droite et le
+    // dernier départ à gauche : c'est là que se trouve la borne.
+    //
+    // @remark O(log(n))
+    size_t lowerBound(const_reference key) const noexcept {
+        const size_t n = size();
+        const T* keys = _keys;
+        size_t k = 1;
+        while (k <= n) {
+            ABR_PREFETCH(keys + std::min(16 * k, n) - 1);
+            k = 2 * k + size_t(keys[k - 1] < key);
+        }
+        return k >> (trailingOnes(k) + 1);
+    }
+
+    //
+    // @brief position dans l'ordre croissant de la case k
+    //
+    // @remark O(log(n))
+    size_t position(size_t k) const noexcept {
+        size_t pos = subtreeSize(2 * k);
+        for (; k > 1; k /= 2) {
+            if (k & 1) pos += subtreeSize(k - 1) + 1; // frère gauche et parent
+        }
+        return pos;
+    }
+
+    //
+    // @brief nombre de cases du sous-arbre de racine k
+    //
+    // Les niveaux complets sous k comptent 2^(H-d) - 1 cases, H étant la
+    // profondeur du dernier niveau et d celle de k ; on ajoute les cases
+    // du dernier niveau qui descendent de k.
+    //
+    // @remark O(1)
+    size_t subtreeSize(size_t k) const noexcept {
+        const size_t n = size();
+        if (k > n) return 0;
+        size_t span = size_t(1) << (floorLog2(n) - floorLog2(k));
+        size_t first = k * span; // premier descendant sur le dernier niveau
+        size_t last = first <= n ? std::min(n - first + 1, span) : 0;
+        return span - 1 + last;
+    }
+
+    //
+    // @brief première case dans l'ordre croissant, 0 si n == 0
+    //
+    static size_t firstSym(size_t n) noexcept {
+        if (n == 0) return 0;
+        size_t k = 1;
+        while (2 * k <= n) k *= 2;
+        return k;
+    }
+
+    //
+    // @brief case suivante dans l'ordre croissant, 0 après la dernière
+    //
+    // @remark O(1) amorti
+    static size_t nextSym(size_t k, size_t n) noexcept {
+        if (2 * k + 1 <= n) {
+            k = 2 * k + 1;
+            while (2 * k <= n) k *= 2;
+            return k;
+        }
+        return k >> (trailingOnes(k) + 1);
+    }
+
+    static size_t trailingOnes(size_t k) noexcept {
+#if defined(__GNUC__)
+        return size_t(__builtin_ctzll(~(unsigned long long) k));
+#else
+        size_t c = 0;
+        for (; k & 1; k >>= 1) ++c;
+        return c;
+#endif
+    }
+
+    static size_t floorLog2(size_t k) noexcept {
+#if defined(__GNUC__)
+        return size_t(63 - __builtin_clzll((unsigned long long) k));
+#else
+        size_t l = 0;
+        while (k >>= 1) ++l;
+        return l;
+#endif
+    }
+
+    std::shared_ptr<const void> _storage; // propriétaire des cases
+    const value_type* _keys = nullptr;    // disposition d'Eytzinger
+    size_t _size = 0;
+};
+
+/**
+ *  @brief Clés uniques : insérer une clé déjà présente ne fait rien.
+ *  Counter, dont hérite chaque noeud, est vide.
+ */
+struct UniqueKeys {
+    static constexpr bool counts = false;
+
+    struct Counter {};
+};
+
+/**
+ *  @brief Multiensemble : chaque noeud compte les copies de sa clé.
+ *
+ *  Insérer une clé présente incrémente sa multiplicité sur place, sans
+ *  allocation. nbElements reste le nombre de noeuds, sur lequel reposent
+ *  le rééquilibrage et les constructions en bloc ; copies tient à côté le
+ *  nombre de copies du sous-arbre, utilisé par size, rank et nth_element.
+ */
+struct Multiset {
+    static constexpr bool counts = true;
+
+    struct Counter {
+        size_t count = 1;  // multiplicité de la clé du noeud
+        size_t copies = 1; // somme des multiplicités du sous-arbre
+    };
+};
+
+/**
+ *  @brief Vrai si une clé de type K se compare directement, avec < et >,
+ *  aux clés de type T : les recherches hétérogènes de BinarySearchTree
+ *  (contains, find, lower_bound, ...) l'utilisent alors telle quelle, sans
+ *  construire de T. L'arbre ordonne par operator<, qui joue ici le rôle
+ *  d'un comparateur transparent comme std::less<>.
+ *
+ *  Entre types arithmétiques, la conversion habituelle vers T est gardée.
+ */
+template<typename K, typename T, typename = void>
+struct TransparentKey : std::false_type {};
+
+template<typename K, typename T>
+struct TransparentKey<K, T, std::void_t<
+        decltype(std::declval<const K&>() < std::declval<const T&>()),
+        decltype(std::declval<const K&>() > std::declval<const T&>()),
+        decltype(std::declval<const T&>() < std::declval<const K&>())>>
+        : std::bool_constant<!std::is_same<std::decay_t<K>, T>::value &&
+                             !(std::is_arithmetic<K>::value &&
+                               std::is_arithmetic<T>::value)> {};
+
+/**
+ *  @brief Arbre binaire de recherche
+ *
+ *  @tparam T       type des clés
+ *  @tparam Tracer  politique notifiée à chaque création / destruction de
+ *                  noeud (NoTrace, CoutTrace, RingBufferTrace<T>, ...)
+ *  @tparam Balance politique de rééquilibrage appliquée lors de insert et
+ *                  deleteElement (NoBalance, WeightBalanced, Scapegoat,
+ *                  AutoRebalance)
+ *  @tparam Alloc   politique d'allocation des noeuds (NewAllocator,
+ *                  SlabAllocator<>)
+ *  @tparam Stats   politique de statistiques alimentée par les descentes
+ *                  et les suppressions (NoStats, TreeStats), voir stats()
+ *  @tparam Keys    clés uniques ou comptées (UniqueKeys, Multiset). En
+ *                  multiensemble, size, rank et nth_element comptent les
+ *                  copies ; les itérateurs et les parcours passent une fois
+ *                  par clé distincte.
+ */
+template<typename T, typename Tracer = NoTrace, typename Balance = NoBalance,
+        typename Alloc = NewAllocator, typename Stats = NoStats,
+        typename Keys = UniqueKeys>
+class BinarySearchTree {
+public:
+
+    using value_type = T;
+    using reference = T&;
+    using const_reference = const T&;
+
+private:
+    /**
+     *  @brief Noeud de l'arbre.
+     *
+     * contient une cle, les liens vers les sous-arbres droit et gauche et
+     * le lien vers le parent, qui permet de parcourir et de remonter
+     * l'arbre sans pile ni récursion. Keys::Counter y ajoute la
+     * multiplicité de la clé en multiensemble.
+     */
+    struct Node : Keys::Counter {
+        const value_type key; // clé non modifiable
+        Node* right;          // sous arbre avec des cles plus grandes
+        Node* left;           // sous arbre avec des cles plus petites
+        Node* parent;         // parent du noeud, nullptr pour la racine
+        size_t nbElements;    // nombre de noeuds dans le sous arbre dont
+        // ce noeud est la racine
+
+        // seul constructeur disponible : la clé est obligatoire et
+        // construite sur place à partir de args
+        template<typename... Args>
+        explicit Node(std::in_place_t, Args&&... args)
+                : key(std::forward<Args>(args)...), right(nullptr), left(nullptr),
+                  parent(nullptr), nbElements(1) {}
+
+        Node() = delete;             // pas de construction par défaut
+        Node(const Node&) = delete;  // pas de construction par copie
+        Node(Node&&) = delete;       // pas de construction par déplacement
+    };
+
+    /**
+     *  @brief  Racine de l'arbre. nullptr si l'arbre est vide
+     */
+    Node* _root;
+
+    /**
+     *  @brief  Traceur notifié des créations / destructions de noeuds
+     */
+    Tracer _tracer;
+
+    /**
+     *  @brief  Politique de rééquilibrage
+     */
+    Balance _balance;
+
+    /**
+     *  @brief  Allocateur des noeuds de cet arbre
+     */
+    Alloc _alloc;
+
+    /**
+     *  @brief  Position où balance_step reprend son balayage
+     */
+    size_t _stepCursor = 0;
+
+    /**
+     *  @brief  Statistiques de cet arbre, mises à jour aussi par les
+     *          recherches const. Elles restent attachées à l'objet : ni
+     *          copiées, ni échangées par swap.
+     */
+    mutable Stats _stats;
+
+    //
+    // @brief Alloue un nouveau noeud et notifie le traceur
+    //
+    // @param args les arguments du constructeur de la clé du noeud
+    //
+    // @remark O(1)
+    template<typename... Args>
+    Node* newNode(Args&&... args) {
+        void* mem = _alloc.template allocate<Node>();
+        Node* n;
+        try {
+            n = new(mem) Node(std::in_place, std::forward<Args>(args)...);
+        } catch (...) {
+            _alloc.template deallocate<Node>(mem);
+            throw;
+        }
+        _tracer.created(n, n->key);
+        return n;
+    }
+
+    //
+    // @brief Notifie le traceur et libère un noeud
+    //
+    // @param n le noeud à libérer. ne peut pas etre nullptr
+    //
+    // @remark O(1)
+    void freeNode(Node* n) noexcept {
+        _tracer.destroyed(n, n->key);
+        n->~Node();
+        _alloc.template deallocate<Node>(n);
+    }
+
+    //
+    // @brief nombre d'éléments d'un sous-arbre
+    //
+    // @param r la racine du sous-arbre. peut valoir nullptr
+    //
+    // @remark O(1)
+    static size_t sizeOf(const Node* r) noexcept {
+        return r == nullptr ? 0 : r->nbElements;
+    }
+
+    //
+    // @brief recalcule nbElements d'un noeud à partir de ses fils
+    //
+    // @param r le noeud a mettre à jour. ne peut pas etre nullptr
+    //
+    // @remark O(1)
+    static void update(Node* r) noexcept {
+        r->nbElements = sizeOf(r->left) + sizeOf(r->right) + 1;
+        updateCopies(r);
+    }
+
+    //
+    // @brief nombre de copies de clés dans un sous-arbre : son nombre de
+    //        noeuds si les clés sont uniques
+    //
+    // @param r la racine du sous-arbre. peut valoir nullptr
+    //
+    // @remark O(1)
+    static size_t copiesOf(const Node* r) noexcept {
+        if constexpr (Keys::counts) {
+            return r == nullptr ? 0 : r->copies;
+        } else {
+            return sizeOf(r);
+        }
+    }
+
+    //
+    // @brief multiplicité de la clé d'un noeud
+    //
+    static size_t countOf(const Node* r) noexcept {
+        if constexpr (Keys::counts) {
+            return r->count;
+        } else {
+            return 1;
+        }
+    }
+
+    //
+    // @brief recalcule le nombre de copies d'un noeud à partir de ses fils
+    //
+    // @remark O(1)
+    static void updateCopies(Node* r) noexcept {
+        if constexpr (Keys::counts)
+            r->copies = copiesOf(r->left) + copiesOf(r->right) + r->count;
+    }
+
+    //
+    // @brief recalcule le nombre de copies de n jusqu'à la racine, après un
+    //        changement de multiplicité qui ne modifie pas la forme
+    //
+    // @remark O(hauteur)
+    static void recount(Node* n) noexcept {
+        for (; n != nullptr; n = n->parent) updateCopies(n);
+    }
+
+    //
+    // @brief reprend les compteurs de src dans dst, sa copie
+    //
+    static void copyCounts(Node* dst, const Node* src) noexcept {
+        dst->nbElements = src->nbElements;
+        if constexpr (Keys::counts) {
+            dst->count = src->count;
+            dst->copies = src->copies;
+        }
+    }
+
+    //
+    // @brief lien (racine ou fils du parent) qui pointe vers un noeud
+    //
+    // @param n le noeud. ne peut pas etre nullptr
+    //
+    // @remark O(1)
+    Node*& linkTo(Node* n) noexcept {
+        return linkTo(n, _root);
+    }
+
+    //
+    // @brief lien qui pointe vers n dans un sous-arbre détaché
+    //
+    // @param n    le noeud. ne peut pas etre nullptr
+    // @param root la racine du sous-arbre contenant n, renvoyée si n n'a
+    //             pas de parent
+    //
+    // @remark O(1)
+    static Node*& linkTo(Node* n, Node*& root) noexcept {
+        if (n->parent == nullptr) return root;
+        return n->parent->left == n ? n->parent->left : n->parent->right;
+    }
+
+    //
+    // @brief rotation à gauche : le fils droit de r prend sa place
+    //
+    // @param r la racine du sous-arbre, modifiée par la fonction
+    //
+    // @remark O(1)
+    static void rotateLeft(Node*& r) noexcept {
+        Node* x = r->right;
+        r->right = x->left;
+        if (x->left != nullptr) x->left->parent = r;
+        x->left = r;
+        x->parent = r->parent;
+        r->parent = x;
+        x->nbElements = r->nbElements;
+        if constexpr (Keys::counts) x->copies = r->copies;
+        update(r);
+        r = x;
+    }
+
+    //
+    // @brief rotation à droite : le fils gauche de r prend sa place
+    //
+    // @param r la racine du sous-arbre, modifiée par la fonction
+    //
+    // @remark O(1)
+    static void rotateRight(Node*& r) noexcept {
+        Node* x = r->left;
+        r->left = x->right;
+        if (x->right != nullptr) x->right->parent = r;
+        x->right = r;
+        x->parent = r->parent;
+        r->parent = x;
+        x->nbElements = r->nbElements;
+        if constexpr (Keys::counts) x->copies = r->copies;
+        update(r);
+        r = x;
+    }
+
+    //
+    // @brief corrige le déséquilibre éventuel d'un noeud selon la politique
+    //        Balance. Les sous-arbres de r doivent déjà être corrigés.
+    //
+    // @param r la racine du sous-arbre, modifiée par la fonction
+    //
+    // @remark O(1)
+    void rebalance(Node*& r) noexcept {
+        size_t sl = sizeOf(r->left);
+        size_t sr = sizeOf(r->right);
+        if (_balance.overweight(sr, sl)) {
+            if (!_balance.singleRotation(sizeOf(r->right->left),
+                                         sizeOf(r->right->right)))
+                rotateRight(r->right);
+            rotateLeft(r);
+        } else if (_balance.overweight(sl, sr)) {
+            if (!_balance.singleRotation(sizeOf(r->left->right),
+                                         sizeOf(r->left->left)))
+                rotateLeft(r->left);
+            rotateRight(r);
+        }
+    }
+
+    //
+    // @brief remonte de n jusqu'à la racine en mettant à jour nbElements et
+    //        en rééquilibrant chaque ancêtre
+    //
+    // Si Balance reconstruit, seul le plus haut ancêtre déséquilibré est
+    // reconstruit, une fois la remontée terminée.
+    //
+    // @param n    le premier noeud à corriger. peut valoir nullptr
+    // @param root la racine du sous-arbre contenant n, modifiée au besoin
+    //
+    // @remark O(hauteur), plus O(taille du sous-arbre reconstruit)
+    void fixUp(Node* n, Node*& root) noexcept {
+        if constexpr (Balance::rebuilds) {
+            Node* scapegoat = nullptr;
+            for (; n != nullptr; n = n->parent) {
+                update(n);
+                if (unbalanced(n, _balance)) scapegoat = n;
+            }
+            if (scapegoat != nullptr) rebuild(scapegoat, root);
+        } else {
+            while (n != nullptr) {
+                update(n);
+                Node*& link = linkTo(n, root);
+                rebalance(link);
+                n = link->parent;
+            }
+        }
+    }
+
+    void fixUp(Node* n) noexcept {
+        fixUp(n, _root);
+    }
+
+    //
+    // @brief vrai si l'un des sous-arbres de n est trop lourd selon rule
+    //
+    // @remark O(1)
+    template<typename Rule>
+    static bool unbalanced(const Node* n, const Rule& rule) noexcept {
+        size_t sl = sizeOf(n->left);
+        size_t sr = sizeOf(n->right);
+        return rule.overweight(sl, sr) || rule.overweight(sr, sl);
+    }
+
+    //
+    // @brief reconstruit un sous-arbre parfaitement équilibré à sa place
+    //
+    // @param n    la racine du sous-arbre. ne peut pas etre nullptr
+    // @param root la racine de l'arbre contenant n
+    //
+    // @remark O(taille du sous-arbre)
+    static void rebuild(Node* n, Node*& root) noexcept {
+        Node* parent = n->parent;
+        Node*& link = linkTo(n, root);
+        size_t cnt = 0;
+        Node* list = nullptr;
+        linearize(n, list, cnt);
+        arborize(link, list, cnt);
+        link->parent = parent;
+    }
+
+    //
+    // @brief plus petit noeud d'un sous-arbre
+    //
+    // @param r la racine du sous-arbre. ne peut pas etre nullptr
+    //
+    // @remark O(hauteur)
+    static Node* leftmost(Node* r) noexcept {
+        while (r->left != nullptr) r = r->left;
+        return r;
+    }
+
+    //
+    // @brief plus grand noeud d'un sous-arbre
+    //
+    // @param r la racine du sous-arbre. ne peut pas etre nullptr
+    //
+    // @remark O(hauteur)
+    static Node* rightmost(Node* r) noexcept {
+        while (r->right != nullptr) r = r->right;
+        return r;
+    }
+
+    //
+    // @brief successeur d'un noeud dans l'ordre symétrique
+    //
+    // @param n le noeud courant. ne peut pas etre nullptr
+    //
+    // @return le successeur, nullptr si n est le plus grand noeud
+    //
+    // @remark O(1) amorti
+    static Node* nextSym(Node* n) noexcept {
+        if (n->right != nullptr) return leftmost(n->right);
+        while (n->parent != nullptr && n->parent->right == n) n = n->parent;
+        return n->parent;
+    }
+
+    //
+    // @brief prédécesseur d'un noeud dans l'ordre symétrique
+    //
+    // @param n le noeud courant. ne peut pas etre nullptr
+    //
+    // @return le prédécesseur, nullptr si n est le plus petit noeud
+    //
+    // @remark O(1) amorti
+    static Node* prevSym(Node* n) noexcept {
+        if (n->left != nullptr) return rightmost(n->left);
+        while (n->parent != nullptr && n->parent->left == n) n = n->parent;
+        return n->parent;
+    }
+
+    //
+    // @brief successeur d'un noeud dans l'ordre pré-ordonné
+    //
+    // @param n le noeud courant. ne peut pas etre nullptr
+    //
+    // @return le successeur, nullptr si n est le dernier noeud
+    //
+    // @remark O(1) amorti
+    static Node* nextPre(Node* n) noexcept {
+        if (n->left != nullptr) return n->left;
+        if (n->right != nullptr) return n->right;
+        while (n->parent != nullptr) {
+            Node* p = n->parent;
+            if (p->left == n && p->right != nullptr) return p->right;
+            n = p;
+        }
+        return nullptr;
+    }
+
+    //
+    // @brief premier noeud d'un sous-arbre dans l'ordre post-ordonné
+    //
+    // @param r la racine du sous-arbre. ne peut pas etre nullptr
+    //
+    // @remark O(hauteur)
+    static Node* firstPost(Node* r) noexcept {
+        for (;;) {
+            if (r->left != nullptr) r = r->left;
+            else if (r->right != nullptr) r = r->right;
+            else return r;
+        }
+    }
+
+    //
+    // @brief successeur d'un noeud dans l'ordre post-ordonné
+    //
+    // @param n le noeud courant. ne peut pas etre nullptr
+    //
+    // @return le successeur, nullptr si n est la racine
+    //
+    // @remark O(1) amorti
+    static Node* nextPost(Node* n) noexcept {
+        Node* p = n->parent;
+        if (p != nullptr && p->left == n && p->right != nullptr)
+            return firstPost(p->right);
+        return p;
+    }
+
+public:
+    /**
+     *  @brief Itérateur bidirectionnel constant parcourant les clés dans
+     *  l'ordre croissant.
+     *
+     *  Il avance en suivant les liens parent : O(1) amorti par pas, sans
+     *  allocation. Il reste valide tant que le noeud pointé n'est pas
+     *  supprimé.
+     */
+    class const_iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() noexcept : _node(nullptr), _tree(nullptr) {}
+
+        reference operator*() const noexcept {
+            return _node->key;
+        }
+
+        pointer operator->() const noexcept {
+            return &_node->key;
+        }
+
+        const_iterator& operator++() noexcept {
+            _node = nextSym(_node);
+            return *this;
+        }
+
+        const_iterator operator++(int) noexcept {
+            const_iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        // --end() donne le plus grand element
+        const_iterator& operator--() noexcept {
+            _node = _node == nullptr ? rightmost(_tree->_root) : prevSym(_node);
+            return *this;
+        }
+
+        const_iterator operator--(int) noexcept {
+            const_iterator old = *this;
+            --*this;
+            return old;
+        }
+
+        bool operator==(const const_iterator& other) const noexcept {
+            return _node == other._node;
+        }
+
+        bool operator!=(const const_iterator& other) const noexcept {
+            return _node != other._node;
+        }
+
+    private:
+        friend class BinarySearchTree;
+
+        const_iterator(Node* node, const BinarySearchTree* tree) noexcept
+                : _node(node), _tree(tree) {}
+
+        Node* _node;                  // nullptr pour end()
+        const BinarySearchTree* _tree;
+    };
+
+    using iterator = const_iterator; // les clés ne sont pas modifiables
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    /**
+     *  @brief Constructeur par défaut. Construit un arbre vide
+     *
+     *  @remark O(1)
+     */
+    BinarySearchTree() : _root(nullptr) {
+        /* ... */
+    }
+
+    /**
+     *  @brief Construit un arbre vide dont la politique de rééquilibrage est
+     *  paramétrée, par exemple
+     *  AutoRebalance(factor, mutationLimit, deferred, amortization)
+     *
+     *  @remark O(1)
+     */
+    explicit BinarySearchTree(const Balance& balance)
+            : _root(nullptr), _balance(balance) {}
+
+    /**
+     *  @brief Construit un arbre parfaitement équilibré contenant les clés
+     *  de [first, last). Les doublons sont ignorés, ou comptés en
+     *  multiensemble.
+     *
+     *  Si la séquence est déjà triée, les noeuds sont créés directement en
+     *  une liste puis arborisés, sans aucune insertion. Sinon les clés sont
+     *  d'abord copiées, triées (en parallèle pour les grandes séquences) et
+     *  dédoublonnées.
+     *
+     *  @param first début de la séquence
+     *  @param last  fin de la séquence
+     *
+     *  @remark O(n) si la séquence est triée, O(n log(n)) sinon
+     */
+    template<typename InputIt, typename = typename
+             std::iterator_traits<InputIt>::iterator_category>
+    BinarySearchTree(InputIt first, InputIt last) : _root(nullptr) {
+        buildFrom(first, last);
+    }
+
+    /**
+     *  @brief Remplace le contenu de l'arbre par les clés de [first, last),
+     *  comme le constructeur par séquence.
+     *
+     *  @param first début de la séquence
+     *  @param last  fin de la séquence
+     *
+     *  @remark O(n) si la séquence est triée, O(n log(n)) sinon
+     */
+    template<typename InputIt, typename = typename
+             std::iterator_traits<InputIt>::iterator_category>
+    void assign(InputIt first, InputIt last) {
+        rebuildWith([&] { buildFrom(first, last); });
+    }
+
+private:
+    //
+    // @brief Remplace le contenu de l'arbre par celui que build construit
+    //        sur place
+    //
+    // Les nouveaux noeuds viennent de l'allocateur de cet arbre et sont
+    // annoncés à son traceur, comme le seront leurs destructions. Si build
+    // échoue (en libérant ce qu'il a créé), l'arbre est inchangé : l'ancien
+    // contenu n'est libéré qu'une fois le nouveau construit.
+    //
+    // @param build construit l'arbre à partir d'une racine vide
+    //
+    // @remark O(n) plus le coût de build
+    template<typename Fn>
+    void rebuildWith(Fn build) {
+        Node* old = _root;
+        _root = nullptr;
+        try {
+            build();
+        } catch (...) {
+            _root = old;
+            throw;
+        }
+        deleteSubTree(old);
+        _stepCursor = 0;
+    }
+
+    //
+    // @brief Construit l'arbre, vide, à partir d'une séquence quelconque
+    //
+    // @param first début de la séquence
+    // @param last  fin de la séquence
+    //
+    // @remark O(n) si la séquence est triée, O(n log(n)) sinon
+    template<typename InputIt>
+    void buildFrom(InputIt first, InputIt last) {
+        using Category = typename std::iterator_traits<InputIt>::iterator_category;
+        if constexpr (std::is_base_of<std::forward_iterator_tag, Category>::value) {
+            if (std::is_sorted(first, last, [](const_reference a, const_reference b) {
+                    return a < b;
+                })) {
+                buildSorted(first, last, size_t(std::distance(first, last)));
+                return;
+            }
+        }
+        std::vector<value_type> keys(first, last);
+        sortKeys(keys);
+        buildSorted(keys.begin(), keys.end(), keys.size());
+    }
+
+    //
+    // @brief Construit l'arbre, vide, à partir d'une séquence triée par ordre
+    //        croissant : les noeuds sont chainés en liste puis arborisés.
+    //
+    // @param first début de la séquence
+    // @param last  fin de la séquence
+    // @param n     longueur de la séquence, doublons compris
+    //
+    // @remark O(n)
+    template<typename It>
+    void buildSorted(It first, It last, size_t n) {
+        _root = makeSubtree(first, last, n);
+        notifyBalanced();
+    }
+
+    //
+    // @brief Crée un sous-arbre parfaitement équilibré à partir d'une
+    //        séquence triée par ordre croissant. Les doublons sont ignorés,
+    //        ou comptés en multiensemble.
+    //
+    // @param first début de la séquence
+    // @param last  fin de la séquence
+    // @param n     longueur de la séquence, doublons compris
+    //
+    // @return la racine du sous-arbre, dont le parent vaut nullptr
+    //
+    // @remark O(n)
+    template<typename It>
+    Node* makeSubtree(It first, It last, size_t n) {
+        _alloc.template reserve<Node>(n);
+        Node* head = nullptr;
+        Node* tail = nullptr;
+        size_t cnt = 0;
+        try {
+            for (; first != last; ++first) {
+                if (tail != nullptr && !(tail->key < *first)) { // doublon
+                    if constexpr (Keys::counts) ++tail->count;
+                    continue;
+                }
+                Node* n = newNode(*first);
+                if (tail == nullptr) {
+                    head = n;
+                } else {
+                    tail->right = n;
+                }
+                tail = n;
+                ++cnt;
+            }
+        } catch (...) {
+            deleteSubTree(head);
+            throw;
+        }
+        Node* tree;
+        arborize(tree, head, cnt);
+        if (tree != nullptr) tree->parent = nullptr;
+        return tree;
+    }
+
+    //
+    // @brief Trie des clés par ordre croissant. Au-delà d'un seuil, des
+    //        tranches sont triées par des threads distincts puis fusionnées.
+    //
+    // @param keys les clés à trier
+    //
+    // @remark O(n log(n))
+    static void sortKeys(std::vector<value_type>& keys) {
+        auto less = [](const_reference a, const_reference b) { return a < b; };
+        const size_t parallelThreshold = size_t(1) << 16;
+        size_t workers = std::thread::hardware_concurrency();
+        if (keys.size() < parallelThreshold || workers < 2) {
+            std::sort(keys.begin(), keys.end(), less);
+            return;
+        }
+
+        workers = std::min(workers, keys.size() / (parallelThreshold / 2));
+        std::vector<size_t> bounds(workers + 1);
+        for (size_t i = 0; i <= workers; ++i) bounds[i] = keys.size() * i / workers;
+
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < workers; ++i) {
+            threads.emplace_back([&, i] {
+                std::sort(keys.begin() + bounds[i], keys.begin() + bounds[i + 1], less);
+            });
+        }
+        for (std::thread& t : threads) t.join();
+
+        // fusionne les tranches deux à deux
+        for (size_t width = 1; width < workers; width *= 2) {
+            for (size_t i = 0; i + width < workers; i += 2 * width) {
+                std::inplace_merge(keys.begin() + bounds[i],
+                                   keys.begin() + bounds[i + width],
+                                   keys.begin() + bounds[std::min(i + 2 * width, workers)],
+                                   less);
+            }
+        }
+    }
+
+public:
+
+    /**
+     *  @brief Constucteur de copie. Les noeuds sont copiés directement dans
+     *  cet arbre, et annoncés à son traceur ; si une allocation échoue, les
+     *  noeuds déjà copiés sont libérés.
+     *
+     *  @param other le BinarySearchTree à copier
+     *
+     *  @remark O(n)
+     *
+     */
+    BinarySearchTree(const BinarySearchTree& other)
+            : _root(nullptr), _balance(other._balance) {
+        copyTree(other._root);
+    }
+
+
+private :
+    /**
+     * @brief Copie dans l'arbre courant, vide, l'arbre de racine node
+     *
+     * @param node la racine de l'arbre où on commence à copier
+     *
+     * @remark O(n)
+     */
+    void copyTree(const Node* node) {
+        _root = cloneSubtree(node);
+    }
+
+    /**
+     * @brief Copie détachée, dans cet arbre, du sous-arbre de racine node
+     *
+     * La copie reproduit la forme de l'original noeud par noeud, en
+     * reprenant les nbElements, sans aucune comparaison de clés. Les deux
+     * arbres sont parcourus en parallèle en pré-ordre grâce aux liens
+     * parent. Les noeuds sont réservés d'un bloc auprès de l'allocateur.
+     *
+     * @param node la racine du sous-arbre à copier. peut valoir nullptr
+     *
+     * @return la racine de la copie, sans parent. Si une allocation échoue,
+     *         les noeuds déjà copiés sont libérés.
+     *
+     * @remark O(taille du sous-arbre)
+     */
+    Node* cloneSubtree(const Node* node) {
+        if (node == nullptr) return nullptr;
+        _alloc.template reserve<Node>(node->nbElements);
+        Node* root = newNode(node->key);
+        copyCounts(root, node);
+
+        const Node* src = node;
+        Node* dst = root;
+        try {
+            for (;;) {
+                if (src->left != nullptr && dst->left == nullptr) {
+                    src = src->left;
+                    dst->left = newNode(src->key);
+                    dst->left->parent = dst;
+                    dst = dst->left;
+                } else if (src->right != nullptr && dst->right == nullptr) {
+                    src = src->right;
+                    dst->right = newNode(src->key);
+                    dst->right->parent = dst;
+                    dst = dst->right;
+                } else if (src != node) { // sous-arbre copié, on remonte
+                    src = src->parent;
+                    dst = dst->parent;
+                    continue;
+                } else {
+                    return root;
+                }
+                copyCounts(dst, src);
+            }
+        } catch (...) {
+            deleteSubTree(root);
+            throw;
+        }
+    }
+
+public:
+    /**
+     *  @brief Opérateur d'affectation par copie. La copie est construite dans
+     *  cet arbre avant que l'ancien contenu ne soit libéré : si elle échoue,
+     *  l'arbre est inchangé.
+     *
+     *  @param other le BinarySearchTree à copier
+     *
+     *  @remark O(n)
+     *
+     */
+    BinarySearchTree& operator=(const BinarySearchTree& other) {
+        if (&other == this) return *this;
+        rebuildWith([&] { copyTree(other._root); });
+        _balance = other._balance;
+        return *this;
+    }
+
+    /**
+     *  @brief Echange le contenu avec un autre BST
+     *  Swap les deux racines et les allocateurs qui possèdent leurs noeuds.
+     *  Les traceurs et les statistiques restent attachés à leur objet.
+     *
+     *  @param other le BST avec lequel on echange le contenu
+     *
+     *  @remark O(1)
+     *
+     */
+    void swap(BinarySearchTree& other) noexcept {
+        std::swap(_root, other._root);
+        std::swap(_balance, other._balance);
+        std::swap(_alloc, other._alloc);
+        std::swap(_stepCursor, other._stepCursor);
+    }
+
+    /**
+     *  @brief constructeur de copie par déplacement, deplace les ressources de
+     *  l'arbre passée en paramètre vers notre arbre courant.
+     *  La racine de l'arbre passée en paramètre pointera sur un nullptr
+     *
+     *  @param other le BST dont on vole le contenu
+     *
+     *  @remark O(1)
+     *
+     */
+    BinarySearchTree(BinarySearchTree&& other) noexcept
+            : _root(move(other._root)), _balance(other._balance),
+              _alloc(std::move(other._alloc)) {
+        other._root = nullptr;
+    }
+
+    /**
+     *  @brief Opérateur d'affectation par déplacement, deplace les ressources de
+     *  l'arbre passée en paramètre vers notre arbre courant.
+     *  L'arbre passé en paramètre reçoit l'ancien contenu de l'arbre courant,
+     *  libéré à sa destruction.
+     *  Il retourne un pointer sur l'arbre courant
+     *
+     *  @param other le BST dont on vole le contenu
+     *
+     *  @remark O(1)
+     *
+     */
+    BinarySearchTree& operator=(BinarySearchTree&& other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    //
+    // @brief Destructeur
+    //
+    // @remark O(n)
+    ~BinarySearchTree() {
+        deleteAll();
+    }
+
+private:
+    //
+    // @brief Détruit tous les noeuds de l'arbre
+    //
+    // Si l'allocateur sait tout libérer d'un coup, que les clés n'ont pas
+    // de destructeur et qu'aucun traceur n'attend les destructions, les
+    // blocs sont rendus directement sans parcourir l'arbre.
+    //
+    // @remark O(n), O(nb blocs) avec un SlabAllocator et des clés triviales
+    void deleteAll() noexcept {
+        if constexpr (Alloc::bulkRelease &&
+                      std::is_trivially_destructible<value_type>::value &&
+                      std::is_same<Tracer, NoTrace>::value) {
+            _alloc.release();
+        } else {
+            deleteSubTree(_root);
+        }
+        _root = nullptr;
+    }
+
+    //
+    // @brief Fonction détruisant (delete) un sous arbre
+    //
+    // @param r la racine du sous arbre à détruire.
+    //          peut éventuellement valoir nullptr
+    //
+    // Les fils gauches sont remontés par rotation à droite jusqu'à ce que la
+    // racine courante n'ait plus de fils gauche, elle peut alors être
+    // détruite sans pile ni récursion.
+    //
+    // @remark O(taille de l'arbre avec r comme racine)
+    void deleteSubTree(Node* r) noexcept {
+        while (r != nullptr) {
+            if (r->left != nullptr) {
+                Node* l = r->left;
+                r->left = l->right;
+                l->right = r;
+                r = l;
+            } else {
+                Node* next = r->right;
+                freeNode(r);
+                r = next;
+            }
+        }
+    }
+
+public:
+    //
+    // @brief Accès au traceur de l'arbre, par exemple pour appeler dump()
+    //        sur un RingBufferTrace
+    //
+    // @remark O(1)
+    const Tracer& tracer() const noexcept {
+        return _tracer;
+    }
+
+    //
+    // @brief Insertion d'une cle dans l'arbre
+    //
+    // @param key la clé à insérer.
+    //
+    // Si la cle est deja presente, cette fonction ne fait rien, ou augmente
+    // sa multiplicité en multiensemble. Sinon le nouveau noeud est accroché
+    // en feuille, puis les ancêtres sont mis à jour (et rééquilibrés selon
+    // Balance) en remontant les liens parent.
+    //
+    // @remark O(hauteur)
+    void insert(const_reference key) {
+        Node* parent;
+        Node** link = insertionLink(key, parent);
+        if (link != nullptr) {
+            attach(newNode(key), parent, link);
+        } else {
+            repeat(parent);
+        }
+    }
+
+    //
+    // @brief Insertion d'une cle temporaire, déplacée dans le noeud
+    //
+    // @param key la clé à insérer. Inchangée si elle est déjà présente.
+    //
+    // @remark O(hauteur)
+    void insert(value_type&& key) {
+        Node* parent;
+        Node** link = insertionLink(key, parent);
+        if (link != nullptr) {
+            attach(newNode(std::move(key)), parent, link);
+        } else {
+            repeat(parent);
+        }
+    }
+
+    //
+    // @brief Insertion d'une cle construite sur place à partir de args
+    //
+    // @param args les arguments du constructeur de la clé
+    //
+    // @return vrai si la clé a été insérée, ou sa multiplicité augmentée en
+    //         multiensemble ; faux si elle était déjà présente
+    //
+    // Un argument unique de type value_type, ou comparable aux clés (voir
+    // TransparentKey), sert directement à la recherche : la clé n'est
+    // construite que si elle est absente. Sinon le noeud est construit
+    // d'abord, puis libéré si sa clé est déjà présente.
+    //
+    // @remark O(hauteur)
+    template<typename... Args>
+    bool emplace(Args&&... args) {
+        Node* parent;
+        if constexpr (sizeof...(Args) == 1 && (searchable<Args>() && ...)) {
+            Node** link = insertionLink(args..., parent);
+            if (link == nullptr) return repeat(parent);
+            attach(newNode(std::forward<Args>(args)...), parent, link);
+        } else {
+            Node* n = newNode(std::forward<Args>(args)...);
+            Node** link = insertionLink(n->key, parent);
+            if (link == nullptr) {
+                freeNode(n);
+                return repeat(parent);
+            }
+            attach(n, parent, link);
+        }
+        return true;
+    }
+
+    //
+    // @brief Insertion d'une cle construite sur place à partir de args,
+    //        seulement si key est absente
+    //
+    // @param key  la clé recherchée, de type value_type ou comparable aux
+    //             clés (voir TransparentKey)
+    // @param args les arguments du constructeur de la clé, qui doit être
+    //             équivalente à key. Ils ne sont pas utilisés si key est
+    //             déjà présente.
+    //
+    // @return un itérateur sur la clé équivalente à key, et vrai si elle
+    //         vient d'être insérée
+    //
+    // Une seule descente, qu'elle trouve la clé ou sa place : c'est la base
+    // de try_emplace et operator[] de BinarySearchMap. En multiensemble, la
+    // multiplicité d'une clé présente est inchangée.
+    //
+    // @remark O(hauteur)
+    template<typename K, typename... Args>
+    std::pair<const_iterator, bool> try_emplace(const K& key, Args&&... args) {
+        static_assert(searchable<K>(), "key doit être comparable aux clés");
+        Node* parent;
+        Node** link = insertionLink(key, parent);
+        if (link == nullptr) return {const_iterator(parent, this), false};
+        Node* n = newNode(std::forward<Args>(args)...);
+        attach(n, parent, link);
+        return {const_iterator(n, this), true};
+    }
+
+private:
+    //
+    // @brief La clé du noeud n est insérée à nouveau : en multiensemble, sa
+    //        multiplicité augmente sur place, sans allocation
+    //
+    // @return vrai si une copie a été ajoutée
+    //
+    // @remark O(hauteur)
+    bool repeat(Node* n) noexcept {
+        if constexpr (Keys::counts) {
+            ++n->count;
+            recount(n);
+        }
+        return Keys::counts;
+    }
+
+    //
+    // @brief vrai si une clé de type K sert à la recherche sans conversion
+    //
+    template<typename K>
+    static constexpr bool searchable() noexcept {
+        return std::is_same<std::decay_t<K>, value_type>::value ||
+               TransparentKey<std::decay_t<K>, value_type>::value;
+    }
+
+    //
+    // @brief Cherche où accrocher key
+    //
+    // @param key    la clé à insérer
+    // @param parent OUT - le futur parent du noeud, nullptr pour la racine ;
+    //               le noeud de même clé si elle est déjà présente
+    //
+    // @return le lien à remplir, nullptr si la clé est déjà présente
+    //
+    // @remark O(hauteur)
+    template<typename K>
+    Node** insertionLink(const K& key, Node*& parent) noexcept {
+        parent = nullptr;
+        Node** link = &_root;
+        size_t depth = 0;
+        size_t lefts = 0;
+        for (; *link != nullptr; ++depth) {
+            parent = *link;
+            if (key < parent->key) {
+                link = &parent->left;
+                ++lefts;
+            } else if (key > parent->key) {
+                link = &parent->right;
+            } else { // La clé est déja présente
+                _stats.descent(StatOp::Insert, depth + 1, 2 * (depth + 1) - lefts);
+                return nullptr;
+            }
+        }
+        _stats.descent(StatOp::Insert, depth, 2 * depth - lefts);
+        if constexpr (Balance::watchesHeight) _balance.descended(depth + 1);
+        return link;
+    }
+
+    //
+    // @brief Accroche la feuille n au lien trouvé par insertionLink, puis
+    //        met à jour (et rééquilibre) les ancêtres
+    //
+    // @remark O(hauteur)
+    void attach(Node* n, Node* parent, Node** link) noexcept {
+        n->parent = parent;
+        *link = n;
+        fixUp(parent);
+        autoBalance(1);
+    }
+
+    //
+    // @brief Signale count modifications à une politique Balance qui
+    //        surveille la hauteur, et rééquilibre l'arbre si elle le demande
+    //
+    // @remark O(1), plus O(n) si l'arbre est rééquilibré
+    void autoBalance(size_t count) noexcept {
+        if constexpr (Balance::watchesHeight) {
+            _balance.mutated(count);
+            if (!_balance.deferred && _balance.due(sizeOf(_root), false)) balance();
+        }
+    }
+
+    //
+    // @brief Signale à une politique Balance qui surveille la hauteur une
+    //        opération globale qui a pu porter la hauteur jusqu'à height en
+    //        modifiant count clés
+    //
+    void reshaped(size_t height, size_t count) noexcept {
+        if constexpr (Balance::watchesHeight) {
+            _balance.descended(height);
+            autoBalance(count);
+        }
+    }
+
+    //
+    // @brief Majorant de la hauteur tenu par la politique Balance, 0 si
+    //        elle ne surveille pas la hauteur
+    //
+    size_t heightBound() const noexcept {
+        if constexpr (Balance::watchesHeight) {
+            return _balance.heightBound();
+        } else {
+            return 0;
+        }
+    }
+
+public:
+    //
+    // @brief Recherche d'une cle.
+    //
+    // @param key la cle a rechercher
+    //
+    // @return vrai si la cle trouvee, faux sinon.
+    //
+    // @remark O(hauteur)
+    bool contains(const_reference key) const noexcept {
+        return find(_root, key) != nullptr;
+    }
+
+    //
+    // @brief itérateur sur la plus petite cle
+    //
+    // @remark O(hauteur)
+    const_iterator begin() const noexcept {
+        return {_root == nullptr ? nullptr : leftmost(_root), this};
+    }
+
+    //
+    // @brief itérateur après la plus grande cle
+    //
+    // @remark O(1)
+    const_iterator end() const noexcept {
+        return {nullptr, this};
+    }
+
+    const_reverse_iterator rbegin() const noexcept {
+        return const_reverse_iterator(end());
+    }
+
+    const_reverse_iterator rend() const noexcept {
+        return const_reverse_iterator(begin());
+    }
+
+    //
+    // @brief Instantané immuable des clés, optimisé pour les lectures
+    //
+    // @return un FrozenTree contenant les clés de l'arbre. Les
+    //         modifications ultérieures de l'arbre ne s'y reflètent pas.
+    //
+    // Réservé aux clés distinctes : un FrozenTree ne garde pas de
+    // multiplicités, ses size, rank et nth_element ne concorderaient pas
+    // avec ceux d'un multiensemble.
+    //
+    // @remark O(n)
+    FrozenTree<value_type> freeze() const {
+        static_assert(!Keys::counts, "l'instantané ne garde pas les multiplicités");
+        return FrozenTree<value_type>(begin(), sizeOf(_root));
+    }
+
+    //
+    // @brief Enregistre les clés dans un fichier binaire
+    //
+    // @param path   chemin du fichier, remplacé s'il existe
+    // @param layout ajoute la disposition d'Eytzinger, qui permet à map de
+    //               répondre sans rien copier
+    //
+    // Le format est décrit par TreeFileHeader. Il dépend de la
+    // représentation de T sur cette machine.
+    //
+    // @exception std::runtime_error si l'écriture échoue
+    //
+    // @remark O(n), plus O(n) de mémoire temporaire pour la disposition
+    void save(const std::string& path, bool layout = true) const {
+        static_assert(std::is_trivially_copyable<value_type>::value,
+                      "save n'enregistre que des clés trivialement copiables");
+        static_assert(alignof(value_type) <= TreeFileHeader::Size,
+                      "alignement des clés non supporté");
+        static_assert(!Keys::counts, "le format ne garde pas les multiplicités");
+        const uint64_t n = size();
+        const uint64_t bytes = n * sizeof(value_type);
+        TreeFileHeader h = {{'A', 'B', 'R', 'K'}, TreeFileHeader::Order,
+                            sizeof(value_type), n, 0};
+        if (layout) h.layout = TreeFileHeader::align(TreeFileHeader::Size + bytes);
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        char pad[TreeFileHeader::Size] = {};
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        out.write(pad, std::streamsize(TreeFileHeader::Size - sizeof(h)));
+        std::vector<value_type> chunk;
+        chunk.reserve(4096);
+        for (const_reference key : *this) {
+            chunk.push_back(key);
+            if (chunk.size() == chunk.capacity()) {
+                writeKeys(out, chunk.data(), chunk.size());
+                chunk.clear();
+            }
+        }
+        writeKeys(out, chunk.data(), chunk.size());
+        if (layout) {
+            out.write(pad, std::streamsize(h.layout - TreeFileHeader::Size - bytes));
+            FrozenTree<value_type> frozen = freeze();
+            writeKeys(out, frozen.data(), frozen.size());
+        }
+        out.close();
+        if (!out) throw std::runtime_error("Impossible d'écrire " + path);
+    }
+
+    //
+    // @brief Remplace le contenu de l'arbre par les clés d'un fichier écrit
+    //        par save
+    //
+    // Les clés triées sont lues dans le fichier projeté, vérifiées, puis
+    // chainées directement en un arbre parfaitement équilibré, sans
+    // insertion. En cas d'erreur, l'arbre est inchangé.
+    //
+    // @exception std::runtime_error si le fichier est illisible ou invalide
+    //
+    // @remark O(n)
+    void load(const std::string& path) {
+        static_assert(std::is_trivially_copyable<value_type>::value,
+                      "load ne lit que des clés trivialement copiables");
+        static_assert(alignof(value_type) <= TreeFileHeader::Size,
+                      "alignement des clés non supporté");
+        MappedFile file(path);
+        TreeFileHeader h = TreeFileHeader::read(file, sizeof(value_type));
+        const value_type* keys = reinterpret_cast<const value_type*>(
+                file.data() + TreeFileHeader::Size);
+        if (std::adjacent_find(keys, keys + h.count, [](const_reference a,
+                                                         const_reference b) {
+                return !(a < b);
+            }) != keys + h.count)
+            throw std::runtime_error("Fichier d'arbre invalide");
+        rebuildWith([&] { buildSorted(keys, keys + h.count, size_t(h.count)); });
+    }
+
+    //
+    // @brief Instantané en lecture seule sur un fichier écrit par save,
+    //        projeté en mémoire
+    //
+    // Si le fichier contient la disposition d'Eytzinger, contains, rank et
+    // nth_element lisent directement les pages projetées : rien n'est
+    // désérialisé et seules les pages visitées sont chargées. Sinon les
+    // clés triées sont recopiées dans un FrozenTree.
+    //
+    // @exception std::runtime_error si le fichier est illisible ou invalide
+    //
+    // @remark O(1) avec la disposition, O(n) sans
+    static FrozenTree<value_type> map(const std::string& path) {
+        static_assert(std::is_trivially_copyable<value_type>::value,
+                      "map ne lit que des clés trivialement copiables");
+        static_assert(alignof(value_type) <= TreeFileHeader::Size,
+                      "alignement des clés non supporté");
+        auto file = std::make_shared<const MappedFile>(path);
+        TreeFileHeader h = TreeFileHeader::read(*file, sizeof(value_type));
+        if (h.layout == 0) {
+            return FrozenTree<value_type>(reinterpret_cast<const value_type*>(
+                    file->data() + TreeFileHeader::Size), size_t(h.count));
+        }
+        const value_type* keys =
+                reinterpret_cast<const value_type*>(file->data() + h.layout);
+        return FrozenTree<value_type>(std::move(file), keys, size_t(h.count));
+    }
+
+private:
+    static void writeKeys(std::ofstream& out, const value_type* keys, size_t n) {
+        out.write(reinterpret_cast<const char*>(keys),
+                  std::streamsize(n * sizeof(value_type)));
+    }
+
+public:
+
+    //
+    // @brief Recherche d'une cle.
+    //
+    // @return un itérateur sur la cle, end() si elle est absente
+    //
+    // @remark O(hauteur)
+    const_iterator find(const_reference key) const noexcept {
+        return {find(_root, key), this};
+    }
+
+    //
+    // @brief première cle qui n'est pas plus petite que key
+    //
+    // @return un itérateur sur cette cle, end() si toutes sont plus petites
+    //
+    // @remark O(hauteur)
+    const_iterator lower_bound(const_reference key) const noexcept {
+        return {lowerBound(_root, key), this};
+    }
+
+    //
+    // @brief première cle strictement plus grande que key
+    //
+    // @return un itérateur sur cette cle, end() si aucune n'est plus grande
+    //
+    // @remark O(hauteur)
+    const_iterator upper_bound(const_reference key) const noexcept {
+        return {upperBound(_root, key), this};
+    }
+
+    //
+    // @brief Recherches hétérogènes : key est comparée directement aux
+    //        cles, sans construire de value_type (voir TransparentKey).
+    //        Par exemple une string_view dans un arbre de std::string.
+    //
+    // @remark O(hauteur)
+    template<typename K, typename = std::enable_if_t<TransparentKey<K, value_type>::value>>
+    bool contains(const K& key) const noexcept {
+        return find(_root, key) != nullptr;
+    }
+
+    template<typename K, typename = std::enable_if_t<TransparentKey<K, value_type>::value>>
+    const_iterator find(const K& key) const noexcept {
+        return {find(_root, key), this};
+    }
+
+    template<typename K, typename = std::enable_if_t<TransparentKey<K, value_type>::value>>
+    const_iterator lower_bound(const K& key) const noexcept {
+        return {lowerBound(_root, key), this};
+    }
+
+    template<typename K, typename = std::enable_if_t<TransparentKey<K, value_type>::value>>
+    const_iterator upper_bound(const K& key) const noexcept {
+        return {upperBound(_root, key), this};
+    }
+
+    template<typename K, typename = std::enable_if_t<TransparentKey<K, value_type>::value>>
+    size_t rank(const K& key) const noexcept {
+        return rank(_root, key);
+    }
+
+private:
+    //
+    // @brief premier noeud d'un sous-arbre dont la cle n'est pas plus
+    //        petite que key, nullptr si toutes le sont
+    //
+    // @remark O(hauteur)
+    template<typename K>
+    static Node* lowerBound(Node* r, const K& key) noexcept {
+        Node* candidate = nullptr;
+        while (r != nullptr) {
+            if (r->key < key) {
+                r = r->right;
+            } else {
+                candidate = r;
+                r = r->left;
+            }
+        }
+        return candidate;
+    }
+
+    //
+    // @brief premier noeud d'un sous-arbre dont la cle est strictement plus
+    //        grande que key, nullptr si aucune ne l'est
+    //
+    // @remark O(hauteur)
+    template<typename K>
+    static Node* upperBound(Node* r, const K& key) noexcept {
+        Node* candidate = nullptr;
+        while (r != nullptr) {
+            if (key < r->key) {
+                candidate = r;
+                r = r->left;
+            } else {
+                r = r->right;
+            }
+        }
+        return candidate;
+    }
+
+    //
+    // @brief Recherche d'une cle dans un sous-arbre
+    //
+    // @param key la cle a rechercher
+    // @param r   la racine du sous-arbre
+    //
+    // @return le noeud contenant la cle, nullptr si elle est absente
+    //
+    // @remark O(hauteur)
+    template<typename K>
+    Node* find(Node* r, const K& key, StatOp op = StatOp::Lookup) const noexcept {
+        size_t depth = 0; // noeuds visités, pour Stats
+        size_t lefts = 0; // descentes à gauche : une seule comparaison
+        for (; r != nullptr; ++depth) {
+            if (key < r->key) { // l'élement recherché se trouve dans le
+                // sous-arbre gauche
+                r = r->left;
+                ++lefts;
+            } else if (key > r->key) { // l'élement recherché se trouve dans le
+                // sous-arbre droit
+                r = r->right;
+            } else {
+                ++depth;
+                break;
+            }
+        }
+        _stats.descent(op, depth, 2 * depth - lefts);
+        return r;
+    }
+
+public:
+    //
+    // @brief Recherche de la cle minimale.
+    //
+    // @return une const reference a la cle minimale
+    //
+    // @exception std::logic_error si l'arbre est vide
+    //
+    // @remark O(hauteur)
+    const_reference min() const { // l'élement min se trouve tout à gauche de l'arbre
+        if (_root == nullptr)
+            throw std::logic_error("L'arbre est vide");
+        return leftmost(_root)->key;
+    }
+
+    //
+    // @brief Supprime le plus petit element de l'arbre, une seule copie en
+    //        multiensemble.
+    //
+    // @exception std::logic_error si l'arbre est vide
+    //
+    // Le noeud le plus à gauche n'a pas de fils gauche : il est détaché
+    // directement, sans nouvelle recherche de sa cle depuis la racine.
+    //
+    // @remark O(hauteur)
+    void deleteMin() {
+        if (_root == nullptr)
+            throw std::logic_error("L'arbre est vide");
+        eraseOne(leftmost(_root));
+    }
+
+
+    //
+    // @brief Supprime l'element de cle key de l'arbre.
+    //
+    // @param key l'element a supprimer
+    //
+    // si l'element n'est pas present, la fonction ne modifie pas
+    // l'arbre mais retourne false. Si l'element est present, elle
+    // retourne vrai
+    //
+    // Un noeud avec au plus un fils est remplacé par ce fils. Un noeud avec
+    // deux fils est remplacé par son successeur (min du sous-arbre droit),
+    // détaché au préalable. Les ancêtres sont ensuite mis à jour en remontant
+    // les liens parent. En multiensemble, toutes les copies de key sont
+    // supprimées : voir erase_one.
+    //
+    // @remark O(hauteur)
+    bool deleteElement(const_reference key) noexcept {
+        return eraseNode(find(_root, key, StatOp::Erase));
+    }
+
+    //
+    // @brief Suppression hétérogène : key est comparée directement aux
+    //        cles, sans construire de value_type (voir TransparentKey)
+    //
+    // @remark O(hauteur)
+    template<typename K, typename = std::enable_if_t<TransparentKey<K, value_type>::value>>
+    bool deleteElement(const K& key) noexcept {
+        return eraseNode(find(_root, key, StatOp::Erase));
+    }
+
+    //
+    // @brief Supprime une copie de key
+    //
+    // @return vrai si key était présente
+    //
+    // En multiensemble, la multiplicité de key diminue sur place et le
+    // noeud n'est retiré qu'avec sa dernière copie. Sinon, comme
+    // deleteElement.
+    //
+    // @remark O(hauteur)
+    bool erase_one(const_reference key) noexcept {
+        return eraseOne(find(_root, key, StatOp::Erase));
+    }
+
+    //
+    // @brief nombre de copies de key : 0 ou 1 si les clés sont uniques
+    //
+    // @remark O(hauteur)
+    size_t count(const_reference key) const noexcept {
+        const Node* n = find(_root, key);
+        return n == nullptr ? 0 : countOf(n);
+    }
+
+private:
+    //
+    // @brief Retire une copie de la clé de z : décrémente sa multiplicité,
+    //        ou retire le noeud s'il n'en a qu'une
+    //
+    // @return faux si z vaut nullptr : rien a supprimer
+    //
+    // @remark O(hauteur)
+    bool eraseOne(Node* z) noexcept {
+        if constexpr (Keys::counts) {
+            if (z != nullptr && z->count > 1) {
+                --z->count;
+                recount(z);
+                return true;
+            }
+        }
+        return eraseNode(z);
+    }
+
+    //
+    // @brief Retire le noeud z trouvé par find et met à jour les ancêtres
+    //
+    // @return faux si z vaut nullptr : rien a supprimer
+    //
+    // @remark O(hauteur)
+    bool eraseNode(Node* z) noexcept {
+        if (z == nullptr) { // rien a supprimer
+            return false;
+        }
+        fixUp(unlink(z));
+        autoBalance(1);
+        return true;
+    }
+
+    //
+    // @brief Retire un noeud de l'arbre et le libère, sans mettre à jour
+    //        les compteurs
+    //
+    // @param z le noeud à retirer. ne peut pas etre nullptr
+    //
+    // @return le premier noeud dont le sous-arbre a changé : les compteurs
+    //         sont à recalculer de ce noeud jusqu'à la racine
+    //
+    // @remark O(hauteur)
+    Node* unlink(Node* z) noexcept {
+        Node* from;
+        if (z->left == nullptr || z->right == nullptr) {
+            Node* child = z->left != nullptr ? z->left : z->right;
+            _stats.erased(child == nullptr ? EraseCase::Leaf : EraseCase::OneChild);
+            if (child != nullptr) child->parent = z->parent;
+            linkTo(z) = child;
+            from = z->parent;
+        } else {
+            _stats.erased(EraseCase::TwoChildren);
+            Node* successor = leftmost(z->right);
+            from = successor->parent == z ? successor : successor->parent;
+            // détache le successeur, qui n'a pas de fils gauche
+            if (successor->right != nullptr)
+                successor->right->parent = successor->parent;
+            linkTo(successor) = successor->right;
+            // le successeur prend la place de z
+            successor->left = z->left;
+            successor->right = z->right;
+            successor->left->parent = successor;
+            if (successor->right != nullptr) successor->right->parent = successor;
+            successor->parent = z->parent;
+            linkTo(z) = successor;
+        }
+        freeNode(z);
+        return from;
+    }
+
+public:
+    //
+    // @brief Insère un lot de clés
+    //
+    // @param first début du lot
+    // @param last  fin du lot
+    //
+    // @return le nombre de clés effectivement insérées
+    //
+    // Le lot est trié au besoin, puis réparti de noeud en noeud en une seule
+    // descente partagée : chaque noeud traversé n'est mis à jour qu'une fois,
+    // et les clés qui tombent dans un même sous-arbre vide y sont accrochées
+    // sous forme d'un sous-arbre équilibré. Avec une politique Balance qui
+    // rééquilibre, ou en multiensemble, les clés sont insérées une à une.
+    //
+    // @remark O(m log(m) + nombre de noeuds traversés)
+    template<typename InputIt>
+    size_t insert_batch(InputIt first, InputIt last) {
+        size_t before = size();
+        if constexpr (Balance::rebalances || Keys::counts) {
+            for (; first != last; ++first) insert(*first);
+        } else {
+            withSortedBatch(first, last, [this](auto lo, auto hi) {
+                insertSorted(lo, hi);
+            });
+            autoBalance(sizeOf(_root) - before);
+        }
+        return size() - before;
+    }
+
+    //
+    // @brief Supprime un lot de clés
+    //
+    // @param first début du lot
+    // @param last  fin du lot
     //
-    // @return vrai si la cle trouvee, faux sinon.
+    // @return le nombre de clés effectivement supprimées
     //
-    // @remark  O(log(n))
-    static bool contains(Node* r, const_reference key) noexcept {
-        if (r == nullptr) { // Si le noeud est nul, il ne contient rien
-            return false;
-        } else if (key < r->key) { // Si la clé est plus petit que la clé du
-            // noeud, l'élement recherché se trouve dans le sous-arbre gauche
-            return contains(r->left, key);
-        } else if (key > r->key) { // Si la clé est plus grand que la clé du
-            // noeud, l'élement recherché se trouve dans le sous-arbre droit
-            return contains(r->right, key);
-        } else { // R.key = key
-            return true;
+    // Même descente partagée que insert_batch. Les noeuds sont supprimés
+    // en remontant, après leurs sous-arbres, si bien que chaque noeud
+    // traversé n'est recompté qu'une fois. La pile de la descente est
+    // réservée avant toute modification, d'après le majorant de hauteur de
+    // la politique Balance ou, à défaut, 4 log2(n + 1) ; si elle ne peut
+    // pas l'être, les clés sont supprimées une à une. Avec une politique
+    // Balance qui rééquilibre, ou en multiensemble, les clés sont
+    // supprimées une à une, une copie par occurrence dans le lot.
+    //
+    // @remark O(m log(m) + nombre de noeuds traversés)
+    template<typename InputIt>
+    size_t erase_batch(InputIt first, InputIt last) {
+        size_t before = size();
+        if constexpr (Balance::rebalances || Keys::counts) {
+            for (; first != last; ++first) erase_one(*first);
+        } else {
+            withSortedBatch(first, last, [this](auto lo, auto hi) {
+                if (lo == hi || _root == nullptr) return;
+                size_t h = heightBound();
+                if (h == 0) // hauteur inconnue : celle d'un arbre aléatoire, avec marge
+                    for (size_t w = size(); w != 0; w >>= 1) h += 4;
+                std::vector<EraseFrame<decltype(lo)>> stack;
+                try {
+                    stack.resize(2 * h + 1);
+                } catch (const std::bad_alloc&) {
+                    for (; lo != hi; ++lo) deleteElement(*lo);
+                    return;
+                }
+                eraseSorted(lo, hi, stack.data(), stack.size());
+            });
+            autoBalance(before - sizeOf(_root));
+        }
+        return before - size();
+    }
+
+    //
+    // @brief Recherche d'un lot de clés
+    //
+    // @param first début du lot
+    // @param last  fin du lot
+    //
+    // @return un vecteur dont l'élément i vaut vrai si first[i] est présent
+    //
+    // Un lot trié est réparti de noeud en noeud en une seule descente
+    // partagée. Sinon les recherches avancent par groupes de BatchWidth en
+    // parallèle, chacune préchargeant son prochain noeud pendant que les
+    // autres progressent, ce qui recouvre les défauts de cache.
+    //
+    // @remark O(m hauteur) au pire
+    template<typename RandomIt>
+    std::vector<bool> contains_batch(RandomIt first, RandomIt last) const {
+        static_assert(std::is_base_of<std::random_access_iterator_tag,
+                              typename std::iterator_traits<RandomIt>::iterator_category>::value,
+                      "contains_batch demande des iterateurs a acces direct");
+        std::vector<bool> found(size_t(last - first));
+        if (std::is_sorted(first, last, [](const_reference a, const_reference b) {
+                return a < b;
+            })) {
+            containsSorted(first, last, found);
+        } else {
+            containsInterleaved(first, found, found.size(), [this](size_t i) {
+                return Cursor{_root, i};
+            });
+        }
+        return found;
+    }
+
+private:
+    //
+    // @brief nombre de recherches menées de front par contains_batch
+    //
+    static constexpr size_t BatchWidth = 8;
+
+    //
+    // @brief Appelle fn(lo, hi) sur les clés du lot triées par ordre croissant.
+    //        Un lot à accès direct déjà trié est passé tel quel, sinon il est
+    //        copié et trié.
+    //
+    template<typename InputIt, typename Fn>
+    void withSortedBatch(InputIt first, InputIt last, Fn fn) {
+        using Category = typename std::iterator_traits<InputIt>::iterator_category;
+        if constexpr (std::is_base_of<std::random_access_iterator_tag, Category>::value) {
+            if (std::is_sorted(first, last, [](const_reference a, const_reference b) {
+                    return a < b;
+                })) {
+                fn(first, last);
+                return;
+            }
+        }
+        std::vector<value_type> keys(first, last);
+        sortKeys(keys);
+        fn(keys.cbegin(), keys.cend());
+    }
+
+    //
+    // @brief Bornes du sous-lot égal à key dans un lot trié [lo, hi)
+    //
+    template<typename It>
+    static std::pair<It, It> splitBatch(It lo, It hi, const_reference key) {
+        auto less = [](const_reference a, const_reference b) { return a < b; };
+        It mid = std::lower_bound(lo, hi, key, less);
+        return {mid, std::upper_bound(mid, hi, key, less)};
+    }
+
+    //
+    // @brief Signale à une politique Balance qui surveille la hauteur que
+    //        l'arbre vient d'être parfaitement équilibré
+    //
+    void notifyBalanced() noexcept {
+        if constexpr (Balance::watchesHeight) {
+            size_t h = 0;
+            for (size_t w = sizeOf(_root); w != 0; w >>= 1) ++h;
+            _balance.balanced(h);
+        }
+    }
+
+    //
+    // @brief Signale à une politique Balance qui surveille la hauteur un
+    //        sous-arbre équilibré de cnt noeuds accroché sous un noeud de
+    //        profondeur depth (0 pour la racine)
+    //
+    void subtreeAttached(size_t depth, size_t cnt) noexcept {
+        if constexpr (Balance::watchesHeight) {
+            size_t h = 0;
+            for (; cnt != 0; cnt >>= 1) ++h;
+            _balance.descended(depth + h);
+        }
+    }
+
+    //
+    // @brief Insère un lot trié en une descente partagée
+    //
+    // Chaque cadre de la pile est visité deux fois : à l'aller le lot est
+    // réparti entre les fils, au retour le noeud est recompté.
+    //
+    // @remark O(nombre de noeuds traversés + m)
+    template<typename It>
+    void insertSorted(It lo, It hi) {
+        if (lo == hi) return;
+        if (_root == nullptr) {
+            _root = makeSubtree(lo, hi, size_t(hi - lo));
+            subtreeAttached(0, sizeOf(_root));
+            return;
+        }
+        struct Frame {
+            Node* node;
+            size_t depth; // la racine est à la profondeur 1
+            It lo, hi;
+            bool expanded;
+        };
+        std::vector<Frame> stack{{_root, 1, lo, hi, false}};
+        // depth : profondeur de parent
+        auto descend = [&](Node*& child, Node* parent, size_t depth, It first,
+                           It last) {
+            if (first == last) return;
+            if (child == nullptr) { // les clés forment un nouveau sous-arbre
+                child = makeSubtree(first, last, size_t(last - first));
+                child->parent = parent;
+                subtreeAttached(depth, child->nbElements);
+            } else {
+                ABR_PREFETCH(child);
+                stack.push_back({child, depth + 1, first, last, false});
+            }
+        };
+        try {
+            while (!stack.empty()) {
+                Frame f = stack.back();
+                if (f.expanded) {
+                    stack.pop_back();
+                    update(f.node);
+                    continue;
+                }
+                stack.back().expanded = true;
+                auto eq = splitBatch(f.lo, f.hi, f.node->key);
+                descend(f.node->left, f.node, f.depth, f.lo, eq.first);
+                descend(f.node->right, f.node, f.depth, eq.second, f.hi);
+            }
+        } catch (...) { // recompte les noeuds déjà modifiés
+            for (auto it = stack.rbegin(); it != stack.rend(); ++it)
+                if (it->expanded) update(it->node);
+            throw;
+        }
+    }
+
+    //
+    // @brief cadre de la descente de eraseSorted : un noeud et son sous-lot,
+    //        visité une fois à l'aller et une fois au retour
+    //
+    template<typename It>
+    struct EraseFrame {
+        Node* node;
+        It lo, hi;
+        bool expanded;
+        bool found;
+    };
+
+    //
+    // @brief Supprime un lot trié en une descente partagée
+    //
+    // Un noeud n'est supprimé qu'au retour, une fois ses sous-arbres
+    // traités. S'il a deux fils, les noeuds entre lui et son successeur
+    // sont recomptés au passage.
+    //
+    // @param stack    pile de la descente, réservée par l'appelant : la
+    //                 suppression n'alloue rien
+    // @param capacity nombre de cadres de stack, non nul. 2 hauteur + 1
+    //                 suffisent (les ancêtres du cadre courant, plus au plus
+    //                 un fils droit en attente par niveau) ; au-delà, les
+    //                 clés sous un noeud trop profond sont supprimées une à
+    //                 une dans son sous-arbre.
+    //
+    // @remark O(nombre de noeuds traversés + m)
+    template<typename It>
+    void eraseSorted(It lo, It hi, EraseFrame<It>* stack, size_t capacity) noexcept {
+        size_t top = 0;
+        stack[top++] = {_root, lo, hi, false, false};
+        while (top != 0) {
+            EraseFrame<It>& f = stack[top - 1];
+            if (f.expanded) {
+                --top;
+                if (f.found) {
+                    Node* parent = f.node->parent;
+                    for (Node* n = unlink(f.node); n != parent; n = n->parent)
+                        update(n);
+                } else {
+                    update(f.node);
+                }
+                continue;
+            }
+            auto eq = splitBatch(f.lo, f.hi, f.node->key);
+            f.expanded = true;
+            f.found = eq.first != eq.second;
+            Node* node = f.node;
+            It flo = f.lo, fhi = f.hi;
+            bool right = node->right != nullptr && eq.second != fhi;
+            bool left = node->left != nullptr && flo != eq.first;
+            if (top + right + left > capacity) {
+                if (left) eraseEach(node, flo, eq.first);
+                if (right) eraseEach(node, eq.second, fhi);
+                continue;
+            }
+            if (right) {
+                ABR_PREFETCH(node->right);
+                stack[top++] = {node->right, eq.second, fhi, false, false};
+            }
+            if (left) {
+                ABR_PREFETCH(node->left);
+                stack[top++] = {node->left, flo, eq.first, false, false};
+            }
+        }
+    }
+
+    //
+    // @brief Supprime une à une les clés de [lo, hi) présentes sous r, r
+    //        exclu, et recompte les noeuds entre chacune et r
+    //
+    // Ni r ni ses ancêtres ne sont recomptés : eraseSorted le fait au retour.
+    //
+    // @remark O(m hauteur du sous-arbre)
+    template<typename It>
+    void eraseEach(Node* r, It lo, It hi) noexcept {
+        for (; lo != hi; ++lo) {
+            Node* z = find(r, *lo, StatOp::Erase);
+            if (z == nullptr) continue;
+            for (Node* n = unlink(z); n != r; n = n->parent)
+                update(n);
+        }
+    }
+
+    //
+    // @brief Recherche d'un lot trié en une descente partagée
+    //
+    // Dès qu'un sous-lot ne contient plus qu'une clé, le partage ne sert
+    // plus : sa descente est confiée aux recherches entrelacées.
+    //
+    // @remark O(nombre de noeuds traversés + m)
+    template<typename RandomIt>
+    void containsSorted(RandomIt first, RandomIt last, std::vector<bool>& found) const {
+        struct Frame {
+            Node* node;
+            RandomIt lo, hi;
+        };
+        std::vector<Frame> stack;
+        std::vector<Cursor> singles;
+        if (_root != nullptr && first != last) stack.push_back({_root, first, last});
+        while (!stack.empty()) {
+            Frame f = stack.back();
+            stack.pop_back();
+            if (f.hi - f.lo == 1) {
+                singles.push_back({f.node, size_t(f.lo - first)});
+                continue;
+            }
+            auto eq = splitBatch(f.lo, f.hi, f.node->key);
+            for (RandomIt it = eq.first; it != eq.second; ++it)
+                found[size_t(it - first)] = true;
+            if (f.node->right != nullptr && eq.second != f.hi) {
+                ABR_PREFETCH(f.node->right);
+                stack.push_back({f.node->right, eq.second, f.hi});
+            }
+            if (f.node->left != nullptr && f.lo != eq.first) {
+                ABR_PREFETCH(f.node->left);
+                stack.push_back({f.node->left, f.lo, eq.first});
+            }
+        }
+        containsInterleaved(first, found, singles.size(),
+                            [&](size_t i) { return singles[i]; });
+    }
+
+    //
+    // @brief recherche en cours : noeud courant et position de la clé
+    //        dans le lot
+    //
+    struct Cursor {
+        Node* node;
+        size_t index;
+    };
+
+    //
+    // @brief Mène jobs recherches, BatchWidth à la fois
+    //
+    // @param first début du lot
+    // @param found résultats, indexés comme le lot
+    // @param jobs  nombre de recherches
+    // @param start start(i) donne le curseur de départ de la i-ème recherche
+    //
+    // @remark O(jobs hauteur)
+    template<typename RandomIt, typename Start>
+    static void containsInterleaved(RandomIt first, std::vector<bool>& found,
+                                    size_t jobs, Start start) {
+        Cursor cursors[BatchWidth];
+        size_t active = 0;
+        size_t next = 0;
+        while (active < BatchWidth && next < jobs) cursors[active++] = start(next++);
+
+        while (active > 0) {
+            for (size_t i = 0; i < active;) {
+                Cursor& c = cursors[i];
+                const_reference key = first[c.index];
+                Node* r = c.node;
+                if (r != nullptr && key < r->key) {
+                    c.node = r->left;
+                } else if (r != nullptr && key > r->key) {
+                    c.node = r->right;
+                } else { // recherche terminée, le curseur prend la suivante
+                    found[c.index] = r != nullptr;
+                    if (next < jobs) {
+                        c = start(next++);
+                    } else {
+                        c = cursors[--active];
+                        continue;
+                    }
+                }
+                ABR_PREFETCH(c.node);
+                ++i;
+            }
+        }
+    }
+
+public:
+    //
+    // @brief taille de l'arbre
+    //
+    // @return le nombre d'elements de l'arbre, copies comprises en
+    //         multiensemble
+    //
+    // @remark O(1)
+    size_t size() const noexcept {
+        return copiesOf(_root);
+    }
+
+    //
+    // @brief hauteur de l'arbre : nombre de noeuds du plus long chemin
+    //        racine-feuille, 0 pour un arbre vide
+    //
+    // Le parcours suit les liens parent, sans pile ni récursion.
+    //
+    // @remark O(n)
+    size_t height() const noexcept {
+        if (_root == nullptr) return 0;
+        size_t h = 1;
+        size_t depth = 1;
+        for (const Node* n = _root;;) {
+            if (n->left != nullptr || n->right != nullptr) {
+                n = n->left != nullptr ? n->left : n->right;
+                h = std::max(h, ++depth);
+                continue;
+            }
+            // feuille : remonte jusqu'au premier sous-arbre droit non visité
+            for (;;) {
+                if (n == _root) return h;
+                const Node* p = n->parent;
+                if (n == p->left && p->right != nullptr) {
+                    n = p->right;
+                    break;
+                }
+                n = p;
+                --depth;
+            }
+        }
+    }
+
+    //
+    // @brief Vérifie les invariants de l'arbre
+    //
+    // @return vrai si les clés sont strictement croissantes dans l'ordre
+    //         symétrique, si les liens parent et les compteurs de chaque
+    //         noeud sont cohérents et, pour une politique Balance qui
+    //         rééquilibre par rotations comme WeightBalanced, si aucun
+    //         sous-arbre ne pèse trop lourd face à son frère ; pour une
+    //         politique qui surveille la hauteur comme AutoRebalance, si
+    //         son majorant est au moins la hauteur de l'arbre
+    //
+    // Destiné aux tests : le parcours suit les liens parent, sans pile.
+    //
+    // @remark O(n)
+    bool valid() const noexcept {
+        if (_root == nullptr) return true;
+        if (_root->parent != nullptr) return false;
+        const Node* prev = nullptr;
+        for (Node* n = leftmost(_root); n != nullptr; n = nextSym(n)) {
+            if (prev != nullptr && !(prev->key < n->key)) return false;
+            if (n->left != nullptr && n->left->parent != n) return false;
+            if (n->right != nullptr && n->right->parent != n) return false;
+            const size_t l = sizeOf(n->left), r = sizeOf(n->right);
+            if (n->nbElements != l + r + 1) return false;
+            if (copiesOf(n) != copiesOf(n->left) + copiesOf(n->right) + countOf(n))
+                return false;
+            if constexpr (Balance::rebalances && !Balance::rebuilds) {
+                if (_balance.overweight(l, r) || _balance.overweight(r, l)) return false;
+            }
+            prev = n;
+        }
+        if constexpr (Balance::watchesHeight) {
+            if (height() > _balance.heightBound()) return false;
+        }
+        return true;
+    }
+
+    //
+    // @brief Instantané des statistiques et de la forme de l'arbre
+    //
+    // Les compteurs ne sont alimentés qu'avec la politique TreeStats ;
+    // la taille et la hauteur sont toujours calculées. heightRatio()
+    // permet par exemple de décider d'appeler balance().
+    //
+    // @remark O(n) pour la hauteur
+    TreeStatsSnapshot stats() const noexcept {
+        TreeStatsSnapshot s;
+        _stats.fill(s);
+        s.size = sizeOf(_root);
+        s.height = height();
+        for (size_t w = s.size; w != 0; w >>= 1) ++s.optimalHeight;
+        return s;
+    }
+
+    //
+    // @brief Remet à zéro les compteurs des statistiques
+    //
+    // @remark O(1)
+    void reset_stats() noexcept {
+        _stats.reset();
+    }
+
+    //
+    // @brief cle en position n
+    //
+    // @return une reference a la cle en position n par ordre croissant des
+    // elements
+    //
+    // @exception std::logic_error si n >= size()
+    //
+    // @remark O(hauteur)
+    const_reference nth_element(size_t n) const {
+        if (n >= size())
+            throw std::logic_error("La position est plus "
+                                   "grand que le nombre "
+                                   "d'éléments");
+        return nth_element(_root, n);
+    }
+
+private:
+    //
+    // @brief cle en position n dans un sous arbre
+    //
+    // @param r la racine du sous arbre. ne peut pas etre nullptr
+    // @param n la position n, inférieure à la taille du sous-arbre
+    //
+    // @return une reference a la cle en position n par ordre croissant des
+    // elements
+    //
+    // @remark O(hauteur)
+    static const_reference nth_element(Node* r, size_t n) noexcept {
+        assert(r != nullptr);
+        for (;;) {
+            size_t s = copiesOf(r->left);
+            if (n < s) {
+                r = r->left;
+            } else if (n >= s + countOf(r)) {
+                n -= s + countOf(r);
+                r = r->right;
+            } else { //Found
+                return r->key;
+            }
+        }
+    }
+
+public:
+    //
+    // @brief position d'une cle dans l'ordre croissant des elements de l'arbre
+    //
+    // @param key la cle dont on cherche le rang
+    //
+    // @return la position entre 0 et size()-1, celle de sa première copie
+    //         en multiensemble ; size_t(-1) si la cle est absente
+    //
+    // @remark O(hauteur)
+    size_t rank(const_reference key) const noexcept {
+        return rank(_root, key);
+    }
+
+    //
+    // @brief nombre de cles strictement plus petites que key, que key soit
+    //        présente ou non
+    //
+    // @param key la cle de référence
+    //
+    // @return une valeur entre 0 et size()
+    //
+    // @remark O(hauteur)
+    size_t rank_lower(const_reference key) const noexcept {
+        size_t before = 0;
+        for (Node* r = _root; r != nullptr;) {
+            if (r->key < key) {
+                before += copiesOf(r->left) + countOf(r);
+                r = r->right;
+            } else {
+                r = r->left;
+            }
+        }
+        return before;
+    }
+
+    //
+    // @brief nombre de cles dans l'intervalle [lo, hi)
+    //
+    // @param lo borne inférieure, incluse
+    // @param hi borne supérieure, exclue
+    //
+    // @remark O(hauteur)
+    size_t count_range(const_reference lo, const_reference hi) const noexcept {
+        if (!(lo < hi)) return 0;
+        return rank_lower(hi) - rank_lower(lo);
+    }
+
+    //
+    // @brief Parcours symétrique des cles de l'intervalle [lo, hi)
+    //
+    // @param lo borne inférieure, incluse
+    // @param hi borne supérieure, exclue
+    // @param f  une fonction capable d'être appelée en recevant une cle
+    //
+    // Descend jusqu'à la première cle non plus petite que lo, puis suit
+    // les liens parent jusqu'à la première cle non plus petite que hi :
+    // seuls les noeuds du chemin et ceux de l'intervalle sont visités.
+    //
+    // @remark O(hauteur + nombre de cles visitées)
+    template<typename Fn>
+    void for_each_in_range(const_reference lo, const_reference hi, Fn f) const {
+        if (!(lo < hi)) return;
+        for (const_iterator it = lower_bound(lo); it != end() && *it < hi; ++it) {
+            f(*it);
+        }
+    }
+
+    //
+    // @brief Supprime les cles de l'intervalle [lo, hi)
+    //
+    // @param lo borne inférieure, incluse
+    // @param hi borne supérieure, exclue
+    //
+    // @return le nombre de cles supprimées
+    //
+    // L'arbre est coupé en lo puis en hi : les cles de l'intervalle forment
+    // alors un sous-arbre détaché, libéré d'un bloc, et les deux autres
+    // parties sont recollées. Un intervalle vide ne modifie pas l'arbre.
+    //
+    // @remark O(hauteur + nombre de cles supprimées)
+    size_t erase_range(const_reference lo, const_reference hi) noexcept {
+        const size_t removed = count_range(lo, hi);
+        if (removed == 0) return 0;
+        if (removed == size()) {
+            deleteAll();
+            autoBalance(removed);
+            return removed;
+        }
+        Node* l;
+        Node* found;
+        Node* r;
+        splitTree(_root, lo, l, found, r);
+        if (found != nullptr) r = joinTrees(nullptr, found, r);
+        Node* range;
+        splitTree(r, hi, range, found, r);
+        if (found != nullptr) r = joinTrees(nullptr, found, r);
+        deleteSubTree(range);
+        _root = concatTrees(l, r);
+        // chaque recollement sans rééquilibrage ajoute au plus un niveau
+        reshaped(heightBound() + 3, removed);
+        return removed;
+    }
+
+private:
+    //
+    // @brief position d'une cle dans l'ordre croissant des elements du sous-arbre
+    //
+    // @param key la cle dont on cherche le rang
+    // @param r la racine du sous arbre
+    //
+    // Une seule descente : chaque fois qu'elle part à droite, le sous-arbre
+    // gauche et le noeud courant précèdent la cle.
+    //
+    // @return la position entre 0 et size()-1, size_t(-1) si la cle est absente
+    //
+    // @remark O(hauteur)
+    template<typename K>
+    static size_t rank(Node* r, const K& key) noexcept {
+        size_t before = 0;
+        while (r != nullptr) {
+            if (key < r->key) {
+                r = r->left;
+            } else if (key > r->key) {
+                before += copiesOf(r->left) + countOf(r);
+                r = r->right;
+            } else { // Key found
+                return before + copiesOf(r->left);
+            }
+        }
+        return size_t(-1); // Key not found
+    }
+
+public:
+    //
+    // @brief Coupe l'arbre en deux selon key
+    //
+    // @param key la clé de coupe, présente ou non
+    //
+    // @return un arbre contenant les clés plus grandes ou égales à key.
+    //         Cet arbre garde les clés plus petites.
+    //
+    // Les noeuds passent d'un arbre à l'autre sans copie, alors que chaque
+    // arbre libère ses noeuds par son propre allocateur : l'allocateur doit
+    // être sans état, comme NewAllocator. Avec SlabAllocator, dont les
+    // blocs appartiennent à un seul arbre, split ne compile pas.
+    //
+    // @remark O(hauteur)
+    BinarySearchTree split(const_reference key) {
+        static_assert(std::is_empty<Alloc>::value,
+                      "split déplace des noeuds : l'allocateur doit être sans état");
+        BinarySearchTree right;
+        right._balance = _balance;
+        Node* l;
+        Node* found;
+        Node* r;
+        splitTree(_root, key, l, found, r);
+        if (found != nullptr) r = joinTrees(nullptr, found, r);
+        _root = l;
+        right._root = r;
+        right.reshaped(heightBound() + 1, 0);
+        return right;
+    }
+
+    //
+    // @brief Accroche à droite les clés de right, qui est vidé
+    //
+    // @param right un arbre dont toutes les clés sont plus grandes que
+    //              celles de cet arbre
+    //
+    // @exception std::logic_error si une clé de right n'est pas plus
+    //            grande que toutes celles de l'arbre
+    //
+    // Comme split, reprend les noeuds de right sans copie : l'allocateur
+    // doit être sans état, join ne compile pas avec SlabAllocator.
+    //
+    // @remark O(hauteur)
+    void join(BinarySearchTree&& right) {
+        static_assert(std::is_empty<Alloc>::value,
+                      "join déplace des noeuds : l'allocateur doit être sans état");
+        if (&right == this || right._root == nullptr) return;
+        if (_root != nullptr && !(rightmost(_root)->key < leftmost(right._root)->key))
+            throw std::logic_error("Les clés à joindre doivent être plus "
+                                   "grandes que celles de l'arbre");
+        const size_t added = sizeOf(right._root);
+        const size_t height = std::max(heightBound(), right.heightBound()) + 1;
+        _root = concatTrees(_root, right._root);
+        right._root = nullptr;
+        reshaped(height, added);
+    }
+
+    //
+    // @brief Ajoute les clés de other absentes de l'arbre
+    //
+    // @param other   l'arbre dont on ajoute les clés, inchangé
+    // @param threads nombre de threads, 0 pour en utiliser autant que de
+    //                coeurs
+    //
+    // @return le nombre de clés ajoutées
+    //
+    // other est d'abord copié dans cet arbre ; si la copie échoue, l'arbre
+    // est inchangé. La fusion elle-même ne fait aucune allocation : voir
+    // combine. Contrairement à split et join, union_with, intersect_with
+    // et difference_with ne font passer aucun noeud d'un arbre à l'autre
+    // et acceptent tout allocateur, SlabAllocator compris.
+    //
+    // @remark O(taille de other + m log(n / m + 1)), m étant la taille du
+    //         plus petit des deux arbres
+    size_t union_with(const BinarySearchTree& other, size_t threads = 1) {
+        if (&other == this) return 0;
+        size_t before = size();
+        Node* b = cloneSubtree(other._root);
+        const size_t height = heightBound() + other.heightBound();
+        try {
+            setOperation<SetOp::Union>(b, threads);
+        } catch (...) {
+            deleteSubTree(b);
+            throw;
+        }
+        reshaped(height, size() - before);
+        return size() - before;
+    }
+
+    //
+    // @brief Ne garde que les clés présentes dans other
+    //
+    // @return le nombre de clés supprimées
+    //
+    // @remark O(m log(n / m + 1))
+    size_t intersect_with(const BinarySearchTree& other, size_t threads = 1) {
+        if (&other == this) return 0;
+        size_t before = size();
+        const size_t height = heightBound() + other.heightBound();
+        setOperation<SetOp::Intersection>(other._root, threads);
+        reshaped(height, before - size());
+        return before - size();
+    }
+
+    //
+    // @brief Supprime les clés présentes dans other
+    //
+    // @return le nombre de clés supprimées
+    //
+    // @remark O(m log(n / m + 1))
+    size_t difference_with(const BinarySearchTree& other, size_t threads = 1) {
+        size_t before = size();
+        if (&other == this) {
+            deleteAll();
+        } else {
+            const size_t height = heightBound() + other.heightBound();
+            setOperation<SetOp::Difference>(other._root, threads);
+            reshaped(height, before - size());
         }
+        return before - size();
     }
 
-public:
+private:
+    enum class SetOp { Union, Intersection, Difference };
+
     //
-    // @brief Recherche de la cle minimale.
+    // @brief niveau de la récursion de combine, sur le noeud b de l'autre
+    //        arbre
     //
-    // @return une const reference a la cle minimale
+    struct SetFrame {
+        Node* b;     // noeud dont la clé a coupé la part de a
+        Node* found; // noeud de a de même clé, nullptr si absent
+        Node* right; // part de a plus grande que b->key, pas encore traitée
+        Node* left;  // résultat pour la part plus petite
+        bool leftDone;
+    };
+
     //
-    // @exception std::logic_error si necessaire
+    // @brief Applique Op entre l'arbre et le sous-arbre b
     //
-    // vous pouvez mettre en oeuvre de manière iterative ou recursive a choix
+    // @param b       racine de l'autre opérande : sous-arbre détaché de cet
+    //                arbre, consommé, pour l'union ; noeuds de other, lus
+    //                seulement, sinon
+    // @param threads nombre de threads demandé
     //
-    // @remark O(log(n))
-    const_reference min() const { // l'élement min se trouve tout à gauche de l'arbre
-        Node* temp = _root;
-        while (temp->left != nullptr) {
-            temp = temp->left;
+    // Les piles de travail sont réservées avant toute modification ; si la
+    // réservation échoue, l'arbre est inchangé. Les threads ne sont
+    // utilisés que si l'allocateur et le traceur sont sans état.
+    //
+    // @exception std::bad_alloc si les piles ne peuvent pas être réservées
+    template<SetOp Op>
+    void setOperation(Node* b, size_t threads) {
+        static_assert(!Keys::counts,
+                      "les opérations ensemblistes ne combinent pas les multiplicités");
+        if constexpr (!std::is_empty<Alloc>::value || !std::is_empty<Tracer>::value) {
+            threads = 1;
         }
-        return temp->key;
+        threads = workerCount(threads);
+        if (sizeOf(_root) + sizeOf(b) < (size_t(1) << 16)) threads = 1;
+        // hauteur d'un arbre équilibré par poids, plus une marge : une pile
+        // pleine n'est pas agrandie, voir combine
+        size_t bits = 1;
+        for (size_t w = sizeOf(b) + 1; w > 1; w >>= 1) ++bits;
+        std::vector<std::vector<SetFrame>> stacks(threads);
+        for (auto& stack : stacks) stack.reserve(3 * bits + 8);
+        _root = combineParallel<Op>(_root, b, stacks.data(), threads);
     }
 
     //
-    // @brief Supprime le plus petit element de l'arbre.
+    // @brief combine en coupant les deux premières moitiés du travail entre
+    //        deux groupes de threads (fork-join)
     //
-    // @exception std::logic_error si necessaire
+    // @param stacks une pile de travail réservée par thread
     //
-    // vous pouvez mettre en oeuvre de manière iterative ou recursive a choix
+    // Si un thread ne peut pas être créé, sa moitié est traitée par
+    // l'appelant.
     //
-    // @remark O(log(n))
-    void deleteMin() {
-        const value_type minKey = min();
-        deleteElement(minKey);
+    // @remark profondeur de récursion O(log(threads))
+    template<SetOp Op>
+    Node* combineParallel(Node* a, Node* b, std::vector<SetFrame>* stacks,
+                          size_t threads) noexcept {
+        if (threads < 2 || a == nullptr || b == nullptr ||
+            sizeOf(a) + sizeOf(b) < (size_t(1) << 14)) {
+            return combine<Op>(a, b, stacks[0]);
+        }
+        Node* l;
+        Node* found;
+        Node* r;
+        splitTree(a, b->key, l, found, r);
+        const size_t half = threads / 2;
+        Node* left = nullptr;
+        std::thread worker;
+        try {
+            worker = std::thread([&] {
+                left = combineParallel<Op>(l, b->left, stacks, half);
+            });
+        } catch (...) {
+            left = combineParallel<Op>(l, b->left, stacks, half);
+        }
+        Node* right = combineParallel<Op>(r, b->right, stacks + half,
+                                          threads - half);
+        if (worker.joinable()) worker.join();
+        return combineStep<Op>(left, found, b, right);
     }
 
-
     //
-    // @brief Supprime l'element de cle key de l'arbre.
+    // @brief Applique Op entre les sous-arbres détachés a et b
     //
-    // @param key l'element a supprimer
+    // Diviser pour régner : a est coupé par la clé de la racine de b, les
+    // deux moitiés sont combinées avec les sous-arbres de b, puis
+    // recollées par joinTrees ou concatTrees. La récursion est simulée par
+    // la pile stack, qui n'est jamais agrandie : si elle est pleine (arbre
+    // déséquilibré), le sous-problème est traité par combineFlat.
     //
-    // si l'element n'est pas present, la fonction ne modifie pas
-    // l'arbre mais retourne false. Si l'element est present, elle
-    // retourne vrai
+    // @param stack pile de travail réservée, vide
     //
-    // Ne pas modifier mais écrire la fonction
-    // récursive privée deleteElement(Node*&,const_reference)
+    // @return la racine du résultat, sans parent
     //
-    // @remark O(log(n))
-    bool deleteElement(const_reference key) noexcept {
-        return deleteElement(_root, key);
+    // @remark O(m log(n / m + 1)) sur des arbres équilibrés, sans allocation
+    template<SetOp Op>
+    Node* combine(Node* a, Node* b, std::vector<SetFrame>& stack) noexcept {
+        Node* result;
+        for (;;) {
+            while (a != nullptr && b != nullptr &&
+                   stack.size() < stack.capacity()) { // descente
+                Node* l;
+                Node* found;
+                Node* r;
+                splitTree(a, b->key, l, found, r);
+                stack.push_back({b, found, r, nullptr, false});
+                a = l;
+                b = b->left;
+            }
+            if (a != nullptr && b != nullptr) { // pile pleine
+                result = combineFlat<Op>(a, b);
+            } else {
+                result = combineLeaf<Op>(a, b);
+            }
+            for (;;) { // remontée
+                if (stack.empty()) return result;
+                SetFrame& f = stack.back();
+                if (!f.leftDone) { // passe à la moitié droite
+                    f.left = result;
+                    f.leftDone = true;
+                    a = f.right;
+                    b = f.b->right;
+                    break;
+                }
+                result = combineStep<Op>(f.left, f.found, f.b, result);
+                stack.pop_back();
+            }
+        }
     }
 
-private:
-    //
-    // @brief Supprime l'element de cle key du sous arbre.
-    //
-    // @param r la racine du sous arbre
-    // @param key l'element a supprimer
     //
-    // si l'element n'est pas present, la fonction ne modifie pas
-    // l'arbre mais retourne false. Si l'element est present, elle
-    // retourne vrai
+    // @brief résultat de Op quand l'un des deux sous-arbres est vide
     //
-    // @remark O(log(n))
-    static bool deleteElement(Node*& r, const_reference key) noexcept {
-        if (r == nullptr) { // Si r est nul, rien a supprimmer
-            return false;
-        }
-        bool deleted;
-        if (key < r->key) { // Si la clé à supprimer est plus petite que la clé du
-            // neoeud, l'émeent se trouve dans le sous-arbre gauche
-            deleted = deleteElement(r->left, key);
-            if (deleted) r->nbElements--;
-            return deleted;
-        } else if (key > r->key) { // Si la clé à supprimer est plus petite que la
-            // clé du neoeud, l'émeent se trouve dans le sous-arbre gauche
-            deleted = deleteElement(r->right, key);
-            if (deleted) r->nbElements--;
-            return deleted;
-        } else { //found
-            if (r->right == nullptr) { // Si le fils droit n'existe pas, on
-                // supprime simplement la feuille
-                Node* temp = r;
-                r = r->left;
-                delete (temp);
-                return true;
-            } else if (r->left == nullptr) { // Si le fils gauche n'existe pas, on
-                // supprime simplement la feuille
-                Node* temp = r;
-                r = r->right;
-                delete (temp);
-                return true;
-            } else { // Possède deux fils
-                Node* subTreeMin = r->right;
-                Node* subTreeMinParent = nullptr;
-                while (subTreeMin->left != nullptr) { // chercher le min dans le
-                    // sous arrbre droit
-                    subTreeMinParent = subTreeMin;
-                    subTreeMin = subTreeMin->left;
-                }
-
-                subTreeMinParent->left = r; // on indque que le nouveau fils est
-                // l'élement à supprimer
-                std::swap(r, subTreeMin);
-                // On swap les fils
-                std::swap(r->left, subTreeMin->left);
-                std::swap(r->right, subTreeMin->right);
-                std::swap(r->nbElements, --subTreeMin->nbElements);
-                deleteElement(r->right, subTreeMin->key);
-
-                return true;
+    template<SetOp Op>
+    Node* combineLeaf(Node* a, Node* b) noexcept {
+        if constexpr (Op == SetOp::Union) {
+            if (a == nullptr) {
+                if (b != nullptr) b->parent = nullptr;
+                return b;
+            }
+        } else if constexpr (Op == SetOp::Intersection) {
+            if (b == nullptr) {
+                deleteSubTree(a);
+                return nullptr;
             }
         }
+        return a;
     }
 
-public:
-    //
-    // @brief taille de l'arbre
     //
-    // @return le nombre d'elements de l'arbre
+    // @brief recolle les résultats left et right autour de la clé de b,
+    //        found étant le noeud de a portant cette clé
     //
-    // @remark O(1)
-    size_t size() const noexcept {
-        return _root->nbElements;
+    template<SetOp Op>
+    Node* combineStep(Node* left, Node* found, Node* b, Node* right) noexcept {
+        if constexpr (Op == SetOp::Union) {
+            if (found != nullptr) {
+                freeNode(b);
+                return joinTrees(left, found, right);
+            }
+            return joinTrees(left, b, right);
+        } else if constexpr (Op == SetOp::Intersection) {
+            if (found != nullptr) return joinTrees(left, found, right);
+            return concatTrees(left, right);
+        } else {
+            if (found != nullptr) freeNode(found);
+            return concatTrees(left, right);
+        }
     }
 
     //
-    // @brief cle en position n
-    //
-    // @return une reference a la cle en position n par ordre croissant des
-    // elements
+    // @brief Op sans pile : les deux sous-arbres sont linéarisés puis
+    //        fusionnés (union) ou a est filtré (intersection, différence),
+    //        et le résultat est arborisé
     //
-    // @exception std::logic_error si nécessaire
+    // @remark O(|a| + |b|)
+    template<SetOp Op>
+    Node* combineFlat(Node* a, Node* b) noexcept {
+        Node* la = nullptr;
+        size_t cnt = 0;
+        linearize(a, la, cnt);
+        Node* head = nullptr;
+        Node** tail = &head;
+        cnt = 0;
+        auto append = [&](Node* n) {
+            *tail = n;
+            tail = &n->right;
+            ++cnt;
+        };
+        if constexpr (Op == SetOp::Union) {
+            Node* lb = nullptr;
+            size_t cb = 0;
+            linearize(b, lb, cb);
+            while (la != nullptr && lb != nullptr) {
+                if (la->key < lb->key) {
+                    append(std::exchange(la, la->right));
+                } else if (lb->key < la->key) {
+                    append(std::exchange(lb, lb->right));
+                } else {
+                    freeNode(std::exchange(lb, lb->right));
+                }
+            }
+            for (Node* rest : {la, lb}) {
+                while (rest != nullptr) append(std::exchange(rest, rest->right));
+            }
+        } else { // b est parcouru en ordre croissant avec a
+            Node* nb = leftmost(b);
+            for (size_t rest = b->nbElements; la != nullptr;) {
+                Node* n = std::exchange(la, la->right);
+                for (; rest != 0 && nb->key < n->key; --rest) nb = nextSym(nb);
+                bool inB = rest != 0 && !(n->key < nb->key);
+                if (inB == (Op == SetOp::Intersection)) {
+                    append(n);
+                } else {
+                    freeNode(n);
+                }
+            }
+        }
+        *tail = nullptr;
+        Node* root;
+        arborize(root, head, cnt);
+        if (root != nullptr) root->parent = nullptr;
+        return root;
+    }
+
     //
-    // ajoutez le code de gestion des exceptions, puis mettez en oeuvre
-    // la fonction recursive nth_element(Node*, n)
+    // @brief fait de k la racine d'un sous-arbre de fils l et r, sans
+    //        rééquilibrer
     //
-    // @remark O(log(n))
-    const_reference nth_element(size_t n) const {
-        if (n > _root->nbElements)
-            throw std::logic_error("La position est plus "
-                                   "grand que le nombre "
-                                   "d'éléments");
-        return nth_element(_root, n);
+    // @remark O(1)
+    static Node* link(Node* l, Node* k, Node* r) noexcept {
+        k->left = l;
+        k->right = r;
+        k->parent = nullptr;
+        if (l != nullptr) l->parent = k;
+        if (r != nullptr) r->parent = k;
+        update(k);
+        return k;
     }
 
-private:
     //
-    // @brief cle en position n dans un sous arbre
+    // @brief Réunit deux sous-arbres détachés autour de k
     //
-    // @param r la racine du sous arbre. ne peut pas etre nullptr
-    // @param n la position n
+    // @param l les clés plus petites que celle de k, peut valoir nullptr
+    // @param k un noeud détaché
+    // @param r les clés plus grandes, peut valoir nullptr
     //
-    // @return une reference a la cle en position n par ordre croissant des
-    // elements
+    // Si l'un des côtés est trop lourd selon Balance, k est accroché le
+    // long du bord intérieur de ce côté, au premier noeud dont le poids
+    // est équilibré avec l'autre côté, puis les noeuds au-dessus sont
+    // corrigés par fixUp.
     //
-    // @remark O(log(n))
-    static const_reference nth_element(Node* r, size_t n) noexcept {
-        assert(r != nullptr);
-        size_t s = r->left == nullptr ? 0 : r->left->nbElements;
-        if (n < s) {
-            return nth_element(r->left, n);
-        } else if (n > s) {
-            return nth_element(r->right, n - s - 1);
-        } else { //Found
-            return r->key;
+    // @return la racine du résultat, sans parent
+    //
+    // @remark O(|log(|l| / |r|)| + 1) sur des arbres équilibrés
+    Node* joinTrees(Node* l, Node* k, Node* r) noexcept {
+        if constexpr (Balance::rebalances) {
+            const size_t sl = sizeOf(l);
+            const size_t sr = sizeOf(r);
+            if (_balance.overweight(sl, sr)) { // descend le bord droit de l
+                Node* p = nullptr;
+                Node* c = l;
+                while (_balance.overweight(sizeOf(c), sr)) {
+                    p = c;
+                    c = c->right;
+                }
+                if (c != nullptr) c->parent = nullptr;
+                link(c, k, r);
+                p->right = k;
+                k->parent = p;
+                fixUp(p, l);
+                return l;
+            }
+            if (_balance.overweight(sr, sl)) { // descend le bord gauche de r
+                Node* p = nullptr;
+                Node* c = r;
+                while (_balance.overweight(sizeOf(c), sl)) {
+                    p = c;
+                    c = c->left;
+                }
+                if (c != nullptr) c->parent = nullptr;
+                link(l, k, c);
+                p->left = k;
+                k->parent = p;
+                fixUp(p, r);
+                return r;
+            }
         }
+        return link(l, k, r);
     }
 
-public:
-    //
-    // @brief position d'une cle dans l'ordre croissant des elements de l'arbre
-    //
-    // @param key la cle dont on cherche le rang
     //
-    // @return la position entre 0 et size()-1, size_t(-1) si la cle est absente
+    // @brief Réunit deux sous-arbres détachés, toutes les clés de l étant
+    //        plus petites que celles de r
     //
-    // Ne pas modifier mais écrire la fonction
-    // récursive privée rank(Node*,const_reference)
+    // Le plus grand noeud de l est détaché et sert de racine à joinTrees.
     //
-    // @remark O(log(n))
-    size_t rank(const_reference key) const noexcept {
-        return rank(_root, key);
+    // @remark O(hauteur de l)
+    Node* concatTrees(Node* l, Node* r) noexcept {
+        if (l == nullptr) return r;
+        if (r == nullptr) return l;
+        Node* m = rightmost(l);
+        Node* p = m->parent;
+        if (m->left != nullptr) m->left->parent = p;
+        if (p == nullptr) {
+            l = m->left;
+        } else {
+            p->right = m->left;
+            fixUp(p, l);
+        }
+        return joinTrees(l, m, r);
     }
 
-private:
     //
-    // @brief position d'une cle dans l'ordre croissant des elements du sous-arbre
+    // @brief Coupe un sous-arbre détaché selon key
     //
-    // @param key la cle dont on cherche le rang
-    // @param r la racine du sous arbre
+    // @param t     la racine du sous-arbre, sans parent
+    // @param key   la clé de coupe
+    // @param l     OUT - les clés plus petites que key
+    // @param found OUT - le noeud de clé key, détaché, nullptr si absent
+    // @param r     OUT - les clés plus grandes que key
     //
-    // @return la position entre 0 et size()-1, size_t(-1) si la cle est absente
+    // Descend jusqu'à key, puis remonte par les liens parent : chaque
+    // ancêtre rejoint, avec son autre sous-arbre, le côté dont il fait
+    // partie par joinTrees. Aucune pile n'est nécessaire.
     //
-    // @remark O(log(n))
-    static size_t rank(Node* r, const_reference key) noexcept {
-        if (r == nullptr || !contains(r, key)) { // Key not found
-            return size_t(-1);
-        } else if (key < r->key) {
-            rank(r->left, key);
-        } else if (key > r->key) {
-            return rank(r->right, key) +
-                   (r->left == nullptr ? 0 : r->left->nbElements) + 1;
-        } else { // Key found
-            return (r->left == nullptr ? 0 : r->left->nbElements);
+    // @remark O(hauteur)
+    void splitTree(Node* t, const_reference key, Node*& l, Node*& found,
+                   Node*& r) noexcept {
+        l = r = found = nullptr;
+        if (t == nullptr) return;
+        Node* p = t;
+        for (;;) {
+            if (key < p->key) {
+                if (p->left == nullptr) break;
+                p = p->left;
+            } else if (p->key < key) {
+                if (p->right == nullptr) break;
+                p = p->right;
+            } else {
+                found = p;
+                l = p->left;
+                r = p->right;
+                if (l != nullptr) l->parent = nullptr;
+                if (r != nullptr) r->parent = nullptr;
+                p = p->parent;
+                break;
+            }
+        }
+        while (p != nullptr) {
+            Node* up = p->parent;
+            if (key < p->key) {
+                Node* pr = p->right;
+                if (pr != nullptr) pr->parent = nullptr;
+                r = joinTrees(r, p, pr);
+            } else {
+                Node* pl = p->left;
+                if (pl != nullptr) pl->parent = nullptr;
+                l = joinTrees(pl, p, l);
+            }
+            p = up;
         }
     }
 
@@ -515,16 +3844,13 @@ public:
     // a nullptr. Cette liste doit toujours respecter les conditions d'un
     // arbre binaire de recherche
     //
-    // Ne pas modifier cette fonction qui sert essentiellement a tester la
-    // fonction recursive linearize(Node*, Node*&, size_t&) utilisée par
-    // la methode publique arborize
-    //
     // @remark O(n)
     void linearize() noexcept {
         size_t cnt = 0;
         Node* list = nullptr;
         linearize(_root, list, cnt);
         _root = list;
+        if constexpr (Balance::watchesHeight) _balance.descended(cnt);
     }
 
 private:
@@ -537,28 +3863,35 @@ private:
     //             element de tree
     // @param cnt  calcule au fure et a mesure le nombre d'elements de la liste
     //             cree. l'effet de la fonction doit etre d'ajouter le nombre
-    //             d'elements du sous-arbre de racine tree. Cependant, vous
-    //             avez uniquement le droit d'utiliser l'opérateur ++.
+    //             d'elements du sous-arbre de racine tree.
+    //
+    // Tant que la racine courante a un fils droit, une rotation à gauche le
+    // fait remonter. Sans fils droit, la racine est le plus grand element
+    // restant : elle est ajoutée en tête de liste et on continue avec son
+    // sous-arbre gauche. Chaque noeud de la liste a pour parent son
+    // prédécesseur.
     //
     // @remark O(n)
     static void linearize(Node* tree, Node*& list, size_t& cnt) noexcept {
-
-        if (tree == nullptr) return;
-
-        if (tree->right != nullptr) { // lineralise le coté droite
-            linearize(tree->right, list, cnt);
-        }
-
-        tree->right = list;
-        list = tree; //Ajoute la racine de l'arbre dans la liste
-        cnt++;
-        list->nbElements = cnt; // MAJ du nbre d'element
-
-        if (tree->left != nullptr) { // lineralise le coté gauche
-            linearize(tree->left, list, cnt);
+        while (tree != nullptr) {
+            if (tree->right != nullptr) { // fait remonter le coté droit
+                Node* r = tree->right;
+                tree->right = r->left;
+                r->left = tree;
+                tree = r;
+            } else {
+                Node* left = tree->left;
+                tree->left = nullptr; // indique que le fils gauche n'existe pas
+                tree->right = list;
+                tree->parent = nullptr;
+                if (list != nullptr) list->parent = tree;
+                list = tree; //Ajoute la racine de l'arbre dans la liste
+                cnt++;
+                list->nbElements = cnt; // MAJ du nbre d'element
+                updateCopies(list);
+                tree = left;
+            }
         }
-
-        tree->left = nullptr; // indique que le fils gauche n'existe pas (nullptr)
     }
 
 
@@ -569,22 +3902,172 @@ public:
     // applique l'algorithme d'equilibrage de l'arbre par linearisation et
     // arborisation
     //
-    // Ne pas modifier cette fonction.
-    //
     // @remark O(n)
     void balance() noexcept {
         size_t cnt = 0;
         Node* list = nullptr;
         linearize(_root, list, cnt);
         arborize(_root, list, cnt);
+        if (_root != nullptr) _root->parent = nullptr;
+        notifyBalanced();
+    }
+
+    //
+    // @brief Rééquilibre l'arbre si la politique AutoRebalance le demande
+    //
+    // Point d'entrée des appelants qui ont choisi AutoRebalance::deferred
+    // et préfèrent rééquilibrer hors du chemin critique, entre deux
+    // rafales d'insertions. Le délai d'amortissement n'est pas appliqué.
+    //
+    // @return vrai si l'arbre a été rééquilibré ; toujours faux si Balance
+    //         ne surveille pas la hauteur
+    //
+    // @remark O(1), plus O(n) si l'arbre est rééquilibré
+    bool maintain() noexcept {
+        if constexpr (Balance::watchesHeight) {
+            if (_balance.due(sizeOf(_root), true)) {
+                balance();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    //
+    // @brief Etape d'équilibrage incrémental, à appeler entre deux requêtes
+    //
+    // @param max_nodes budget de l'étape, en noeuds parcourus ou déplacés
+    //
+    // @return le nombre de rotations et de reconstructions effectuées
+    //
+    // Les étapes successives balaient l'arbre par ordre croissant, en
+    // reprenant là où la précédente s'est arrêtée. Un sous-arbre d'au plus
+    // max_nodes noeuds est vérifié d'un coup et reconstruit si l'un de ses
+    // noeuds est trop lourd au sens de WeightBalanced. Un noeud plus grand
+    // ne peut pas être reconstruit dans le budget : il est corrigé par des
+    // rotations, tant que chacune allège son côté lourd. Un balayage complet
+    // sans aucune correction laisse un arbre de hauteur O(log(n)).
+    //
+    // Une reconstruction ne rend pas le sous-arbre plus haut, mais chaque
+    // rotation peut enfoncer d'un niveau son côté léger : une politique qui
+    // surveille la hauteur en est avertie à la fin de l'étape.
+    //
+    // @remark O(max_nodes + hauteur)
+    size_t balance_step(size_t max_nodes) noexcept {
+        const WeightBalanced rule;
+        size_t done = 0;
+        size_t rotations = 0;
+        size_t budget = max_nodes;
+        size_t n = sizeOf(_root);
+        if (n == 0 || budget == 0) return 0;
+        if (_stepCursor >= n) _stepCursor = 0;
+
+        Node** link = &_root;
+        size_t base = 0; // rang du plus petit noeud de *link
+        while (budget != 0) {
+            Node* r = *link;
+            if (r->nbElements <= max_nodes) { // tranche vérifiée d'un coup
+                if (r->nbElements > budget) break;
+                budget -= r->nbElements;
+                if (!balancedSubtree(r, rule)) {
+                    rebuild(r, _root);
+                    ++done;
+                }
+                _stepCursor = base + r->nbElements;
+            } else if (unbalanced(r, rule) && improve(*link)) {
+                --budget;
+                ++done;
+                ++rotations;
+                continue;
+            } else {
+                --budget;
+                size_t at = base + sizeOf(r->left);
+                if (_stepCursor < at) {
+                    link = &r->left;
+                    continue;
+                }
+                if (_stepCursor > at) {
+                    base = at + 1;
+                    link = &r->right;
+                    continue;
+                }
+                _stepCursor = at + 1;
+            }
+            if (_stepCursor >= n) _stepCursor = 0; // balayage terminé
+            link = &_root;
+            base = 0;
+        }
+        if (rotations != 0) reshaped(heightBound() + rotations, 0);
+        return done;
     }
 
 private:
+    //
+    // @brief vrai si aucun noeud du sous-arbre n'est trop lourd selon rule
+    //
+    // @param r la racine du sous-arbre. ne peut pas etre nullptr
+    //
+    // @remark O(taille du sous-arbre), sans pile grâce aux liens parent
+    template<typename Rule>
+    static bool balancedSubtree(Node* r, const Rule& rule) noexcept {
+        Node* stop = r->parent;
+        for (Node* n = leftmost(r); n != stop;) {
+            if (unbalanced(n, rule)) return false;
+            if (n->right != nullptr) {
+                n = leftmost(n->right);
+            } else {
+                while (n->parent != stop && n == n->parent->right) n = n->parent;
+                n = n->parent;
+            }
+        }
+        return true;
+    }
+
+    //
+    // @brief rotation simple ou double qui allège le côté lourd de r, choisie
+    //        pour minimiser le plus gros des deux nouveaux sous-arbres
+    //
+    // @param r la racine du sous-arbre, modifiée par la fonction
+    //
+    // @return faux si aucune rotation n'allège le côté lourd ; r est alors
+    //         inchangé
+    //
+    // @remark O(1)
+    static bool improve(Node*& r) noexcept {
+        size_t sl = sizeOf(r->left);
+        size_t sr = sizeOf(r->right);
+        bool right = sr > sl;
+        Node* h = right ? r->right : r->left;
+        size_t light = right ? sl : sr;
+        size_t heavy = right ? sr : sl;
+        size_t inner = sizeOf(right ? h->left : h->right);
+        size_t outer = sizeOf(right ? h->right : h->left);
+        // rotation simple : (light + 1 + inner, outer)
+        size_t single = std::max(light + 1 + inner, outer);
+        // rotation double : le petit-fils intérieur g remonte
+        size_t dbl = heavy;
+        if (inner != 0) {
+            Node* g = right ? h->left : h->right;
+            size_t gi = sizeOf(right ? g->left : g->right);
+            size_t go = sizeOf(right ? g->right : g->left);
+            dbl = std::max(light + 1 + gi, go + 1 + outer);
+        }
+        if (std::min(single, dbl) >= heavy) return false;
+        if (dbl < single) {
+            if (right) rotateRight(r->right);
+            else rotateLeft(r->left);
+        }
+        if (right) rotateLeft(r);
+        else rotateRight(r);
+        return true;
+    }
+
     //
     // @brief arborise les cnt premiers elements d'une liste en un arbre
     //
     // @param tree reference dans laquelle il faut ecrire la racine de l'arbre
-    //             arborise par la fonction
+    //             arborise par la fonction. Le parent de cette racine est
+    //             laissé à la charge de l'appelant.
     // @param list IN - reference a la tete de la liste a parcourir. La liste
     //                  est composee de Node dont le pointer left est nullptr
     //             OUT - debut de la suite de la liste dont on a utilise cnt
@@ -592,134 +4075,335 @@ private:
     // @param cnt  nombre d'elements de la liste que l'on doit utiliser pour
     //             arboriser le sous arbre
     //
+    // Un sous-arbre de cnt elements a (cnt - 1) / 2 elements à gauche et
+    // cnt / 2 à droite. La récursion est simulée par une pile de cadres :
+    // chaque niveau divise cnt par deux, la pile ne dépasse donc jamais le
+    // nombre de bits de size_t.
+    //
     // @remark O(n)
     static void arborize(Node*& tree, Node*& list, size_t cnt) noexcept {
-        if (cnt == 0) {
-            tree = nullptr;// Le le counter est à zero donc l'arbre est vide
-            return;
-        }
-
-        Node* RG = list->right;
-        arborize(RG, list, (cnt - 1) / 2); //arborise le noeud suivant dans la
-        // liste, on remonte d'un hauteur dont le cnt est div par 2 et moins 1
-        // pour le côté gauche de l'arbre
-
-        tree = list; // on indique que la racine est le 1er elem de la list (pop())
+        struct Frame {
+            size_t cnt;  // taille du sous-arbre à construire
+            Node* root;  // nullptr tant que le sous-arbre gauche est en cours
+        };
+        Frame stack[sizeof(size_t) * 8 + 1];
+        size_t top = 0;
+        Node* done; // racine du dernier sous-arbre terminé
 
-        list->nbElements = cnt; // Maj du nbre d'élément
-
-        tree->left = RG; // L'elem a droit est le suivant que la liste
-        list = list->right; // Maj de la list, la tête de la liste est le noeud
-        // suivant
+        for (;;) {
+            while (cnt != 0) { // descend à gauche
+                stack[top++] = {cnt, nullptr};
+                cnt = (cnt - 1) / 2;
+            }
+            done = nullptr;
 
-        arborize(tree->right, list, cnt / 2); // on arborise le côté droit de
-        // l'arbre, on remonte d'un hauteur dont le cnt est div par 2
+            for (;;) {
+                if (top == 0) {
+                    tree = done;
+                    return;
+                }
+                Frame& f = stack[top - 1];
+                if (f.root == nullptr) { // sous-arbre gauche terminé
+                    Node* root = list; // la racine est la tête de liste
+                    list = list->right;
+                    root->left = done;
+                    if (done != nullptr) done->parent = root;
+                    root->nbElements = f.cnt; // Maj du nbre d'élément
+                    f.root = root;
+                    cnt = f.cnt / 2; // construit le sous-arbre droit
+                    break;
+                }
+                // sous-arbre droit terminé
+                f.root->right = done;
+                if (done != nullptr) done->parent = f.root;
+                updateCopies(f.root);
+                done = f.root;
+                --top;
+            }
+        }
     }
 
 public:
     //
-    // @brief Parcours pre-ordonne de l'arbre
+    // @brief Appelle f(key) sur chaque cle, en parallèle
     //
-    // @param f une fonction capable d'être appelée en recevant une cle
-    //          en parametre. Pour le noeud n courrant, l'appel sera
-    //          f(n->key);
+    // @param f       fonction appelée de façon concurrente, dans un ordre
+    //                quelconque
+    // @param threads nombre de threads, 0 pour en utiliser autant que de
+    //                coeurs
     //
-    // @remark O(n)
+    // L'arbre est découpé d'après nbElements en sous-arbres de tailles
+    // voisines, que les threads se répartissent au fur et à mesure.
+    //
+    // @exception la première exception levée par f, une fois tous les
+    //            threads terminés
+    //
+    // @remark O(n / threads + threads * hauteur)
     template<typename Fn>
-    void visitPre(Fn f) {
-        //Appele de la fonction récursive
-        visitPre(f, _root);
+    void parallel_for_each(Fn f, size_t threads = 0) const {
+        parallelVisit([&f](size_t, const Node* n) { f(n->key); }, threads);
     }
 
-private :
     //
-    // @brief Parcours pre-ordonne de l'arbre
+    // @brief Appelle f(position, key) sur chaque cle, en parallèle
     //
-    // @param f une fonction capable d'être appelée en recevant une cle
-    //          en parametre. Pour le noeud n courrant, l'appel sera
-    //          f(n->key);
-    // @param root  La racine de sous arbre actuelle
+    // @param f       fonction appelée de façon concurrente. position est le
+    //                rang de la cle par ordre croissant, par exemple pour
+    //                remplir un tableau trié. Avec Multiset, f est appelée
+    //                une fois par noeud et position est celle du noeud parmi
+    //                les clés distinctes, pas le rang qu'en donne rank
+    // @param threads nombre de threads, 0 pour en utiliser autant que de
+    //                coeurs
     //
-    // @remark O(n)
+    // Chaque thread parcourt des tranches de positions contiguës, chacune
+    // par ordre croissant.
+    //
+    // @exception la première exception levée par f, une fois tous les
+    //            threads terminés
+    //
+    // @remark O(n / threads + threads * hauteur)
     template<typename Fn>
-    void visitPre(Fn f, Node* root) {
-        if (root != nullptr) {
-            f(root->key);
-            visitPre(f, root->left);
-            visitPre(f, root->right);
+    void parallel_for_each_ordered(Fn f, size_t threads = 0) const {
+        parallelVisit([&f](size_t pos, const Node* n) { f(pos, n->key); }, threads);
+    }
+
+    //
+    // @brief equilibre l'arbre en parallèle
+    //
+    // @param threads nombre de threads, 0 pour en utiliser autant que de
+    //                coeurs
+    //
+    // Les noeuds sont d'abord rangés par position dans un tableau, en
+    // parallèle. Les premiers niveaux de l'arbre équilibré sont ensuite
+    // reliés directement, puis les sous-arbres restants, tous de tailles
+    // voisines, sont arborisés en parallèle. L'arbre obtenu est le même que
+    // celui de balance().
+    //
+    // Sur un petit arbre, ou si le tableau ne peut pas être alloué, se
+    // rabat sur balance().
+    //
+    // @remark O(n / threads + threads * hauteur), O(n) en mémoire
+    void parallel_balance(size_t threads = 0) noexcept {
+        const size_t parallelThreshold = size_t(1) << 16;
+        const size_t n = sizeOf(_root);
+        threads = workerCount(threads);
+        if (threads < 2 || n < parallelThreshold) {
+            balance();
+            return;
+        }
+
+        // sous-arbre de l'arbre équilibré : positions [lo, lo + cnt)
+        struct Part {
+            size_t lo;
+            size_t cnt;
+            size_t parent; // position du parent, n pour la racine
+            bool left;     // côté du parent
+        };
+        std::vector<Node*> order;
+        std::vector<Part> spine; // noeuds reliés directement
+        std::vector<Part> parts; // sous-arbres arborisés en parallèle
+        try {
+            order.resize(n);
+            parallelVisit([&order](size_t pos, Node* node) { order[pos] = node; },
+                          threads);
+            const size_t grain = (n + 4 * threads - 1) / (4 * threads);
+            std::vector<Part> todo{{0, n, n, false}};
+            while (!todo.empty()) {
+                Part p = todo.back();
+                todo.pop_back();
+                if (p.cnt <= grain) {
+                    parts.push_back(p);
+                    continue;
+                }
+                size_t mid = p.lo + (p.cnt - 1) / 2; // même forme qu'arborize
+                spine.push_back({mid, p.cnt, p.parent, p.left});
+                todo.push_back({p.lo, (p.cnt - 1) / 2, mid, true});
+                todo.push_back({mid + 1, p.cnt / 2, mid, false});
+            }
+        } catch (...) {
+            balance();
+            return;
+        }
+
+        // plus aucune allocation : l'arbre peut être modifié
+        auto attach = [&](const Part& p, Node* sub) {
+            Node* parent = p.parent == n ? nullptr : order[p.parent];
+            if (sub != nullptr) sub->parent = parent;
+            if (parent == nullptr) {
+                _root = sub;
+            } else if (p.left) {
+                parent->left = sub;
+            } else {
+                parent->right = sub;
+            }
+        };
+        for (const Part& p : spine) {
+            order[p.lo]->nbElements = p.cnt;
+            attach(p, order[p.lo]);
+        }
+        runParallel(parts.size(), threads, [&](size_t i) {
+            const Part& p = parts[i];
+            Node* sub = nullptr;
+            if (p.cnt != 0) {
+                for (size_t k = p.lo; k + 1 < p.lo + p.cnt; ++k) order[k]->right = order[k + 1];
+                Node* list = order[p.lo];
+                arborize(sub, list, p.cnt);
+            }
+            attach(p, sub);
+        });
+        // les copies d'un noeud relié directement dépendent de ses
+        // sous-arbres : spine est en ordre préfixe, on le remonte à l'envers
+        if constexpr (Keys::counts) {
+            for (size_t i = spine.size(); i-- > 0;) updateCopies(order[spine[i].lo]);
         }
+        notifyBalanced();
     }
 
-public:
+private:
+    //
+    // @brief sous-arbre à parcourir et position de sa plus petite cle
+    //
+    struct Chunk {
+        Node* root;
+        size_t first;
+    };
+
+    static size_t workerCount(size_t threads) noexcept {
+        if (threads != 0) return threads;
+        return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
 
     //
-    // @brief Parcours symétrique de l'arbre
+    // @brief Exécute fn(0) .. fn(tasks - 1) sur au plus threads threads,
+    //        dont l'appelant. Chaque thread prend la tâche suivante dès
+    //        qu'il a fini la sienne.
     //
-    // @param f une fonction capable d'être appelée en recevant une cle
-    //          en parametre. Pour le noeud n courrant, l'appel sera
-    //          f(n->key);
+    // Si un thread ne peut pas être créé, les autres font son travail.
     //
-    // @remark O(n)
+    // @exception la première exception levée par fn, une fois tous les
+    //            threads terminés ; les tâches non commencées sont abandonnées
     template<typename Fn>
-    void visitSym(Fn f) {
-        //Appele de la fonction récursive
-        visitSym(f, _root);
+    static void runParallel(size_t tasks, size_t threads, Fn fn) {
+        std::atomic<size_t> next{0};
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;
+        auto work = [&] {
+            for (size_t i; (i = next.fetch_add(1)) < tasks;) {
+                try {
+                    fn(i);
+                } catch (...) {
+                    if (!failed.exchange(true)) error = std::current_exception();
+                    next.store(tasks);
+                }
+            }
+        };
+        std::vector<std::thread> pool;
+        for (size_t t = 1; t < std::min(threads, tasks); ++t) {
+            try {
+                pool.emplace_back(work);
+            } catch (...) {
+                break;
+            }
+        }
+        work();
+        for (std::thread& t : pool) t.join();
+        if (error) std::rethrow_exception(error);
     }
 
-private :
+    //
+    // @brief Appelle fn(position, noeud) sur chaque noeud, en parallèle
+    //
+    // Les plus gros sous-arbres sont coupés à leur racine, visitée
+    // directement, jusqu'à ce que chaque morceau fasse au plus n / (4 *
+    // threads) noeuds. Un arbre dégénéré ne se découpe pas : le nombre de
+    // coupes est borné, quitte à laisser un gros morceau à un seul thread.
+    //
+    // @remark O(n / threads + threads * hauteur)
+    template<typename Fn>
+    void parallelVisit(Fn fn, size_t threads) const {
+        const size_t n = sizeOf(_root);
+        if (n == 0) return;
+        threads = workerCount(threads);
+        const size_t grain = std::max<size_t>((n + 4 * threads - 1) / (4 * threads), 1024);
+
+        std::vector<Chunk> chunks;
+        std::vector<Chunk> todo{{_root, 0}};
+        for (size_t cuts = 0; !todo.empty();) {
+            Chunk c = todo.back();
+            todo.pop_back();
+            if (sizeOf(c.root) <= grain || cuts == 64 * threads) {
+                chunks.push_back(c);
+                continue;
+            }
+            ++cuts;
+            size_t pos = c.first + sizeOf(c.root->left);
+            fn(pos, c.root);
+            if (c.root->left != nullptr) todo.push_back({c.root->left, c.first});
+            if (c.root->right != nullptr) todo.push_back({c.root->right, pos + 1});
+        }
 
+        runParallel(chunks.size(), threads, [&](size_t i) {
+            const Chunk& c = chunks[i];
+            Node* node = leftmost(c.root);
+            for (size_t k = 0, cnt = sizeOf(c.root);;) {
+                fn(c.first + k, node);
+                if (++k == cnt) break;
+                node = nextSym(node);
+            }
+        });
+    }
 
+public:
+    //
+    // @brief Parcours pre-ordonne de l'arbre
     //
-    // @brief onction résusive privé pour le parcours symetrique de l'arbre
+    // @param f une fonction capable d'être appelée en recevant une cle
+    //          en parametre. Pour le noeud n courrant, l'appel sera
+    //          f(n->key);
     //
-    // @param f     une fonction capable d'être appelée en recevant une cle
-    //              en parametre. Pour le noeud n courrant, l'appel sera
-    //              f(n->key);
-    // @param root  La racine de sous arbre actuelle
+    // Le parcours suit les liens parent, sans pile ni récursion.
     //
     // @remark O(n)
     template<typename Fn>
-    void visitSym(Fn f, Node* root) {
-        if (root != nullptr) {
-            visitSym(f, root->left);
-            f(root->key);
-            visitSym(f, root->right);
+    void visitPre(Fn f) {
+        for (Node* n = _root; n != nullptr; n = nextPre(n)) {
+            f(n->key);
         }
     }
 
-public:
-
     //
-    // @brief Parcours post-ordonne de l'arbre
+    // @brief Parcours symétrique de l'arbre
     //
     // @param f une fonction capable d'être appelée en recevant une cle
     //          en parametre. Pour le noeud n courrant, l'appel sera
     //          f(n->key);
     //
+    // Le parcours suit les liens parent, sans pile ni récursion.
+    //
     // @remark O(n)
     template<typename Fn>
-    void visitPost(Fn f) {
-        //Appele de la fonction récursive
-        visitPost(f, _root);
+    void visitSym(Fn f) {
+        if (_root == nullptr) return;
+        for (Node* n = leftmost(_root); n != nullptr; n = nextSym(n)) {
+            f(n->key);
+        }
     }
 
-private :
-
     //
     // @brief Parcours post-ordonne de l'arbre
     //
     // @param f une fonction capable d'être appelée en recevant une cle
     //          en parametre. Pour le noeud n courrant, l'appel sera
     //          f(n->key);
-    // @param root  La racine de sous arbre actuelle
+    //
+    // Le parcours suit les liens parent, sans pile ni récursion.
     //
     // @remark O(n)
     template<typename Fn>
-    void visitPost(Fn f, Node* root) {
-        if (root != nullptr) {
-            visitPost(f, root->left);
-            visitPost(f, root->right);
-            f(root->key);
+    void visitPost(Fn f) {
+        if (_root == nullptr) return;
+        for (Node* n = firstPost(_root); n != nullptr; n = nextPost(n)) {
+            f(n->key);
         }
     }
 
@@ -800,4 +4484,6 @@ public:
             }
         }
     }
-};
\ No newline at end of file
+};
+
+#endif // ABR_CPP
@@ -0,0 +1,1672 @@
+//
+//  Benchmarks de BinarySearchTree
+//
+//  Compilation : g++ -std=c++17 -O2 bench.cpp -o bench
+//                (ajouter -march=native pour la recherche AVX2 de BTree)
+//  Usage       : ./bench [groupe] [n]
+//
+//  groupe vaut "all" par défaut, sinon le nom d'un des groupes ci-dessous.
+//
+
+#include <chrono>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <string_view>
+#include <set>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#include "abr.cpp"
+#include "btree.cpp"
+#include "concurrent.cpp"
+#include "lockfree.cpp"
+#include "persistent.cpp"
+#include "map.cpp"
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+// Accumulateur empêchant le compilateur d'éliminer les appels mesurés
+volatile size_t sink;
+
+//
+// @brief temps moyen par opération, en nanosecondes
+//
+// @param ops nombre d'opérations effectuées par f
+// @param f   la fonction à mesurer
+//
+template<typename Fn>
+double nsPerOp(size_t ops, Fn f) {
+    auto start = Clock::now();
+    f();
+    auto stop = Clock::now();
+    return chrono::duration<double, nano>(stop - start).count() /
+           double(ops ? ops : 1);
+}
+
+//
+// @brief n clés distinctes dans l'ordre demandé
+//
+// @param order "sorted", "reverse" ou "random"
+// @param n     le nombre de clés
+//
+vector<int> makeKeys(const string& order, size_t n) {
+    vector<int> keys(n);
+    for (size_t i = 0; i < n; ++i) keys[i] = int(i);
+    if (order == "reverse") {
+        reverse(keys.begin(), keys.end());
+    } else if (order == "random") {
+        shuffle(keys.begin(), keys.end(), mt19937(42));
+    }
+    return keys;
+}
+
+//
+// @brief mesure insert, contains, nth_element et deleteElement sur un
+//        flux de clés
+//
+template<typename Tree>
+void benchTree(const char* name, const string& order, const vector<int>& keys) {
+    Tree tree;
+    vector<int> probes = keys;
+    shuffle(probes.begin(), probes.end(), mt19937(7));
+
+    double insert = nsPerOp(keys.size(), [&] {
+        for (int k : keys) tree.insert(k);
+    });
+    double contains = nsPerOp(probes.size(), [&] {
+        size_t found = 0;
+        for (int k : probes) found += tree.contains(k);
+        sink = found;
+    });
+    double nth = nsPerOp(keys.size(), [&] {
+        size_t acc = 0;
+        for (size_t i = 0; i < keys.size(); ++i)
+            acc += size_t(tree.nth_element(size_t(probes[i])));
+        sink = acc;
+    });
+    double erase = nsPerOp(probes.size(), [&] {
+        for (int k : probes) tree.deleteElement(k);
+    });
+
+    printf("%-16s %-8s n=%-9zu insert %9.1f  contains %9.1f  "
+           "nth_element %9.1f  deleteElement %9.1f  (ns/op)\n",
+           name, order.c_str(), keys.size(), insert, contains, nth, erase);
+}
+
+//
+// @brief arbre naïf contre arbre équilibré par poids sur des flux triés,
+//        triés à l'envers et aléatoires
+//
+void benchBalance(size_t n) {
+    for (const string order : {"sorted", "reverse", "random"}) {
+        vector<int> keys = makeKeys(order, n);
+        benchTree<BinarySearchTree<int>>("NoBalance", order, keys);
+        benchTree<BinarySearchTree<int, NoTrace, WeightBalanced>>(
+                "WeightBalanced", order, keys);
+        benchTree<BinarySearchTree<int, NoTrace, Scapegoat>>(
+                "Scapegoat", order, keys);
+    }
+}
+
+//
+// @brief pause unique de balance() contre étapes balance_step(budget) sur
+//        un arbre dégénéré : pire étape, nombre d'étapes et temps total
+//        jusqu'à un balayage sans correction
+//
+void benchIncremental(size_t n) {
+    vector<int> keys = makeKeys("sorted", n);
+    BinarySearchTree<int> tree(keys.begin(), keys.end());
+    tree.linearize();
+    double full = nsPerOp(1, [&] { tree.balance(); });
+    printf("incremental n=%-9zu balance()          pause %10.1f us\n", n, full / 1e3);
+
+    for (size_t budget : {1024, 4096, 16384}) {
+        tree.linearize();
+        size_t steps = 0;
+        double worst = 0, total = 0;
+        for (size_t idle = 0; idle * budget < 2 * n; ++steps) {
+            size_t fixes = 0;
+            double ns = nsPerOp(1, [&] { fixes = tree.balance_step(budget); });
+            worst = max(worst, ns);
+            total += ns;
+            idle = fixes != 0 ? 0 : idle + 1;
+        }
+        printf("incremental n=%-9zu balance_step(%-5zu) worst %10.1f us  "
+               "steps %7zu  total %8.1f ms\n",
+               n, budget, worst / 1e3, steps, total / 1e6);
+    }
+}
+
+//
+// @brief arbre dégénéré de n clés : aucune opération ne doit faire
+//        déborder la pile. Mesure chaque opération sur cet arbre.
+//
+void benchStress(size_t n) {
+    const size_t probes = 4;
+    vector<int> keys = makeKeys("random", n);
+    auto* tree = new BinarySearchTree<int>;
+    auto report = [](const char* op, size_t count, double ns) {
+        printf("%-14s n=%-9zu %12.1f ns/op\n", op, count, ns);
+    };
+
+    report("insert(random)", n, nsPerOp(n, [&] {
+        for (int k : keys) tree->insert(k);
+    }));
+    report("linearize", n, nsPerOp(n, [&] { tree->linearize(); }));
+
+    // l'arbre est maintenant une liste : les clés les plus grandes sont
+    // au bout du chemin le plus long
+    report("contains", probes, nsPerOp(probes, [&] {
+        size_t found = 0;
+        for (size_t i = 0; i < probes; ++i) found += tree->contains(int(n - 1 - i));
+        sink = found;
+    }));
+    report("insert", probes, nsPerOp(probes, [&] {
+        for (size_t i = 0; i < probes; ++i) tree->insert(int(n + i));
+    }));
+    report("deleteElement", probes, nsPerOp(probes, [&] {
+        for (size_t i = 0; i < probes; ++i) tree->deleteElement(int(n + i));
+    }));
+    report("visitPre", n, nsPerOp(n, [&] {
+        size_t acc = 0;
+        tree->visitPre([&](int k) { acc += size_t(k); });
+        sink = acc;
+    }));
+    report("visitSym", n, nsPerOp(n, [&] {
+        size_t acc = 0;
+        tree->visitSym([&](int k) { acc += size_t(k); });
+        sink = acc;
+    }));
+    report("visitPost", n, nsPerOp(n, [&] {
+        size_t acc = 0;
+        tree->visitPost([&](int k) { acc += size_t(k); });
+        sink = acc;
+    }));
+
+    report("copy", n, nsPerOp(n, [&] {
+        BinarySearchTree<int> copy(*tree);
+        sink = copy.size();
+    }));
+
+    report("balance", n, nsPerOp(n, [&] { tree->balance(); }));
+    tree->linearize();
+    report("~tree", n, nsPerOp(n, [&] { delete tree; }));
+}
+
+//
+// @brief construction, recherche et destruction d'un arbre de n clés
+//        aléatoires selon la politique d'allocation
+//
+template<typename Tree>
+void benchAllocTree(const char* name, const vector<int>& keys) {
+    vector<int> probes = keys;
+    shuffle(probes.begin(), probes.end(), mt19937(7));
+    auto* tree = new Tree;
+
+    double build = nsPerOp(keys.size(), [&] {
+        for (int k : keys) tree->insert(k);
+    });
+    double lookup = nsPerOp(probes.size(), [&] {
+        size_t found = 0;
+        for (int k : probes) found += tree->contains(k);
+        sink = found;
+    });
+    double churn = nsPerOp(probes.size(), [&] {
+        for (size_t i = 0; i < probes.size(); i += 2) {
+            tree->deleteElement(probes[i]);
+            tree->insert(probes[i]);
+        }
+    });
+    double destroy = nsPerOp(keys.size(), [&] { delete tree; });
+
+    printf("%-14s n=%-9zu build %8.1f  lookup %8.1f  delete+insert %8.1f  "
+           "destroy %8.1f  (ns/op)\n",
+           name, keys.size(), build, lookup, churn * 2, destroy);
+}
+
+//
+// @brief new / delete par noeud contre allocation par blocs
+//
+void benchAlloc(size_t n) {
+    vector<int> keys = makeKeys("random", n);
+    benchAllocTree<BinarySearchTree<int>>("NewAllocator", keys);
+    benchAllocTree<BinarySearchTree<int, NoTrace, NoBalance, SlabAllocator<>>>(
+            "SlabAllocator", keys);
+}
+
+//
+// @brief parcours complet et scan de k clés à partir d'une borne :
+//        itérateurs contre visitSym
+//
+void benchIter(size_t n) {
+    const size_t k = 100;
+    const size_t scans = 1000;
+    BinarySearchTree<int, NoTrace, WeightBalanced> tree;
+    for (int key : makeKeys("random", n)) tree.insert(key);
+    vector<int> starts = makeKeys("random", scans);
+    for (int& s : starts) s = int(size_t(s) * (n / scans));
+
+    double fullVisit = nsPerOp(n, [&] {
+        size_t acc = 0;
+        tree.visitSym([&](int key) { acc += size_t(key); });
+        sink = acc;
+    });
+    double fullIter = nsPerOp(n, [&] {
+        size_t acc = 0;
+        for (int key : tree) acc += size_t(key);
+        sink = acc;
+    });
+    double scanVisit = nsPerOp(scans, [&] {
+        size_t acc = 0;
+        for (int lo : starts) {
+            size_t taken = 0;
+            tree.visitSym([&](int key) {
+                if (key >= lo && taken < k) {
+                    acc += size_t(key);
+                    ++taken;
+                }
+            });
+        }
+        sink = acc;
+    });
+    double scanIter = nsPerOp(scans, [&] {
+        size_t acc = 0;
+        for (int lo : starts) {
+            auto it = tree.lower_bound(lo);
+            for (size_t taken = 0; taken < k && it != tree.end(); ++taken, ++it)
+                acc += size_t(*it);
+        }
+        sink = acc;
+    });
+
+    printf("full scan    n=%-9zu visitSym %10.1f  iterator %10.1f  (ns/key)\n",
+           n, fullVisit, fullIter);
+    printf("range scan   k=%-9zu visitSym %10.1f  iterator %10.1f  (ns/scan)\n",
+           k, scanVisit, scanIter);
+}
+
+//
+// @brief copie structurelle contre réinsertion des clés en pré-ordre
+//
+template<typename Tree>
+void benchCopyTree(const char* name, const char* shape, Tree& tree) {
+    double reinsert = nsPerOp(tree.size(), [&] {
+        Tree copy;
+        tree.visitPre([&](int k) { copy.insert(k); });
+        sink = copy.size();
+    });
+    double clone = nsPerOp(tree.size(), [&] {
+        Tree copy(tree);
+        sink = copy.size();
+    });
+    printf("%-14s %-10s n=%-9zu reinsert %9.1f  copy %9.1f  (ns/key)\n",
+           name, shape, tree.size(), reinsert, clone);
+}
+
+template<typename Tree>
+void benchCopyShapes(const char* name, size_t n) {
+    Tree tree;
+    for (int k : makeKeys("random", n)) tree.insert(k);
+    benchCopyTree(name, "random", tree);
+
+    // réinsérer une liste est quadratique : on se limite à 20000 clés
+    Tree list;
+    for (int k : makeKeys("random", min<size_t>(n, 20000))) list.insert(k);
+    list.linearize();
+    benchCopyTree(name, "degenerate", list);
+}
+
+void benchCopy(size_t n) {
+    benchCopyShapes<BinarySearchTree<int>>("NewAllocator", n);
+    benchCopyShapes<BinarySearchTree<int, NoTrace, NoBalance, SlabAllocator<>>>(
+            "SlabAllocator", n);
+}
+
+//
+// @brief démarrage à froid : n insertions puis balance() contre
+//        construction par séquence triée ou non
+//
+void benchBulk(size_t n) {
+    vector<int> shuffled = makeKeys("random", n);
+    vector<int> sorted = makeKeys("sorted", n);
+    using Tree = BinarySearchTree<int>;
+
+    // les constructions par séquence passent en premier : après la
+    // destruction d'un arbre construit par insertions aléatoires, malloc
+    // rend des noeuds dispersés qui faussent les mesures suivantes
+    double fromSorted = nsPerOp(n, [&] {
+        Tree tree(sorted.begin(), sorted.end());
+        sink = tree.size();
+    });
+    double fromShuffled = nsPerOp(n, [&] {
+        Tree tree(shuffled.begin(), shuffled.end());
+        sink = tree.size();
+    });
+    double loop = nsPerOp(n, [&] {
+        Tree tree;
+        for (int k : shuffled) tree.insert(k);
+        tree.balance();
+        sink = tree.size();
+    });
+    printf("bulk load    n=%-9zu insert+balance %8.1f  sorted range %8.1f  "
+           "unsorted range %8.1f  (ns/key)\n",
+           n, loop, fromSorted, fromShuffled);
+}
+
+//
+// @brief lots de m clés (moitié présentes) sur un arbre de n clés :
+//        boucles clé par clé contre API par lots, lot trié ou non
+//
+void benchBatch(size_t n) {
+    const size_t m = 4096;
+    const size_t rounds = 64;
+    using Tree = BinarySearchTree<int>;
+    vector<int> keys = makeKeys("random", n);
+    for (int& k : keys) k *= 2; // les clés impaires sont absentes
+    Tree base(keys.begin(), keys.end());
+    mt19937 gen(11);
+
+    for (const bool sortedBatch : {false, true}) {
+        vector<vector<int>> batches(rounds, vector<int>(m));
+        for (auto& b : batches) {
+            for (int& k : b) k = int(gen() % (2 * n));
+            if (sortedBatch) sort(b.begin(), b.end());
+        }
+        const char* kind = sortedBatch ? "sorted" : "unsorted";
+        const size_t ops = m * rounds;
+
+        double containsLoop = nsPerOp(ops, [&] {
+            size_t acc = 0;
+            for (auto& b : batches)
+                for (int k : b) acc += base.contains(k);
+            sink = acc;
+        });
+        double containsBatch = nsPerOp(ops, [&] {
+            size_t acc = 0;
+            for (auto& b : batches) acc += size_t(base.contains_batch(b.begin(), b.end())[0]);
+            sink = acc;
+        });
+
+        Tree t1(base), t2(base);
+        double insertLoop = nsPerOp(ops, [&] {
+            for (auto& b : batches)
+                for (int k : b) t1.insert(k);
+        });
+        double insertBatch = nsPerOp(ops, [&] {
+            for (auto& b : batches) t2.insert_batch(b.begin(), b.end());
+        });
+        double eraseLoop = nsPerOp(ops, [&] {
+            for (auto& b : batches)
+                for (int k : b) t1.deleteElement(k);
+        });
+        double eraseBatch = nsPerOp(ops, [&] {
+            for (auto& b : batches) t2.erase_batch(b.begin(), b.end());
+        });
+
+        printf("batch %-8s n=%-9zu m=%zu  contains %7.1f / %7.1f  "
+               "insert %7.1f / %7.1f  erase %7.1f / %7.1f  (ns/key, loop / batch)\n",
+               kind, n, m, containsLoop, containsBatch, insertLoop, insertBatch,
+               eraseLoop, eraseBatch);
+    }
+}
+
+//
+// @brief rank, rank_lower, count_range et nth_element sur un arbre issu
+//        d'insertions aléatoires puis après balance()
+//
+void benchRank(size_t n) {
+    vector<int> keys = makeKeys("random", n);
+    vector<int> probes = keys;
+    shuffle(probes.begin(), probes.end(), mt19937(3));
+    BinarySearchTree<int> tree;
+    for (int k : keys) tree.insert(k);
+
+    for (const char* shape : {"random", "balanced"}) {
+        if (string(shape) == "balanced") tree.balance();
+        double rank = nsPerOp(n, [&] {
+            size_t acc = 0;
+            for (int k : probes) acc += tree.rank(k);
+            sink = acc;
+        });
+        double lower = nsPerOp(n, [&] {
+            size_t acc = 0;
+            for (int k : probes) acc += tree.rank_lower(k);
+            sink = acc;
+        });
+        double range = nsPerOp(n, [&] {
+            size_t acc = 0;
+            for (int k : probes) acc += tree.count_range(k, k + 1000);
+            sink = acc;
+        });
+        double nth = nsPerOp(n, [&] {
+            size_t acc = 0;
+            for (int k : probes) acc += size_t(tree.nth_element(size_t(k)));
+            sink = acc;
+        });
+        printf("rank %-10s n=%-9zu rank %7.1f  rank_lower %7.1f  count_range %7.1f  "
+               "nth_element %7.1f  (ns/op)\n", shape, n, rank, lower, range, nth);
+    }
+
+    // sur une liste de m clés, une descente coûte O(m) : l'ancienne
+    // version, qui relançait contains à chaque niveau, coûtait O(m^2)
+    size_t m = min<size_t>(n, 20000);
+    BinarySearchTree<int> list(keys.begin(), keys.begin() + long(m));
+    list.linearize();
+    double rank = nsPerOp(m, [&] {
+        size_t acc = 0;
+        for (size_t i = 0; i < m; ++i) acc += list.rank(keys[i]);
+        sink = acc;
+    });
+    printf("rank %-10s n=%-9zu rank %7.1f  (ns/op)\n", "degenerate", m, rank);
+}
+
+//
+// @brief arbre vivant (équilibré) contre instantané figé : contains, rank
+//        et nth_element sur des clés aléatoires
+//
+template<typename Lookup>
+void benchLookups(const char* name, size_t n, const vector<int>& probes,
+                  const Lookup& tree) {
+    size_t q = probes.size();
+    double contains = nsPerOp(q, [&] {
+        size_t acc = 0;
+        for (int k : probes) acc += tree.contains(k);
+        sink = acc;
+    });
+    double rank = nsPerOp(q, [&] {
+        size_t acc = 0;
+        for (int k : probes) acc += tree.rank(k);
+        sink = acc;
+    });
+    double nth = nsPerOp(q, [&] {
+        size_t acc = 0;
+        for (int k : probes) acc += size_t(tree.nth_element(size_t(k) / 2 % n));
+        sink = acc;
+    });
+    printf("%-10s n=%-10zu contains %7.1f  rank %7.1f  nth_element %7.1f  (ns/op)\n",
+           name, n, contains, rank, nth);
+}
+
+void benchFrozen(size_t n) {
+    for (size_t size : {size_t(1000), size_t(1000000), n}) {
+        vector<int> keys = makeKeys("sorted", size);
+        for (int& k : keys) k *= 2; // les clés impaires sont absentes
+        vector<int> probes(1000000);
+        mt19937 gen(5);
+        for (int& p : probes) p = int(gen() % (2 * size));
+
+        BinarySearchTree<int> tree(keys.begin(), keys.end());
+        benchLookups("live", size, probes, tree);
+        FrozenTree<int> frozen = tree.freeze();
+        benchLookups("frozen", size, probes, frozen);
+    }
+}
+
+//
+// @brief arbre binaire contre arbre B à noeuds larges : mises à jour sur un
+//        flux aléatoire, puis recherches sur un arbre de n clés
+//
+void benchWide(size_t n) {
+    vector<int> keys = makeKeys("random", n);
+    using Binary = BinarySearchTree<int, NoTrace, WeightBalanced, SlabAllocator<>>;
+    benchTree<Binary>("binary", "random", keys);
+    benchTree<BTree<int, 16>>("btree<16>", "random", keys);
+    benchTree<BTree<int, 32>>("btree<32>", "random", keys);
+    benchTree<BTree<int, 64>>("btree<64>", "random", keys);
+
+    vector<int> probes(1000000);
+    mt19937 gen(5);
+    for (int& p : probes) p = int(gen() % n);
+    {
+        Binary tree(keys.begin(), keys.end());
+        benchLookups("binary", n, probes, tree);
+    }
+    BTree<int, 32> wide;
+    for (int k : keys) wide.insert(k);
+    benchLookups("btree<32>", n, probes, wide);
+}
+
+//
+// @brief BinarySearchTree protégé par un verrou global, référence pour
+//        ConcurrentBinarySearchTree
+//
+class LockedTree {
+public:
+    void insert(int key) {
+        lock_guard<mutex> lock(_m);
+        _tree.insert(key);
+    }
+
+    bool deleteElement(int key) {
+        lock_guard<mutex> lock(_m);
+        return _tree.deleteElement(key);
+    }
+
+    bool contains(int key) const {
+        lock_guard<mutex> lock(_m);
+        return _tree.contains(key);
+    }
+
+    size_t rank(int key) const {
+        lock_guard<mutex> lock(_m);
+        return _tree.rank(key);
+    }
+
+    int nth_element(size_t n) const {
+        lock_guard<mutex> lock(_m);
+        return _tree.nth_element(n);
+    }
+
+    size_t size() const {
+        lock_guard<mutex> lock(_m);
+        return _tree.size();
+    }
+
+private:
+    BinarySearchTree<int> _tree;
+    mutable mutex _m;
+};
+
+//
+// @brief débit (millions d'opérations par seconde) de threads mêlant
+//        lectures (contains, rank, nth_element à tour de rôle) et écritures
+//        (insert, deleteElement) sur des clés aléatoires de [0, 2n)
+//
+template<typename Tree>
+double throughput(Tree& tree, size_t n, size_t threads, unsigned writePercent,
+                  size_t opsPerThread) {
+    vector<thread> pool;
+    double ns = nsPerOp(1, [&] {
+        for (size_t t = 0; t < threads; ++t) {
+            pool.emplace_back([&, t] {
+                mt19937 gen(unsigned(17 + t));
+                size_t acc = 0;
+                for (size_t i = 0; i < opsPerThread; ++i) {
+                    int key = int(gen() % (2 * n));
+                    if (gen() % 100 < writePercent) {
+                        if (key & 1) tree.insert(key); else tree.deleteElement(key);
+                    } else if (i % 3 == 0) {
+                        acc += tree.contains(key);
+                    } else if (i % 3 == 1) {
+                        acc += tree.rank(key);
+                    } else {
+                        acc += size_t(tree.nth_element(size_t(key) % (n / 2)));
+                    }
+                }
+                sink = acc;
+            });
+        }
+        for (thread& th : pool) th.join();
+    });
+    return double(threads * opsPerThread) / ns * 1e3;
+}
+
+//
+// @brief Test de ConcurrentBinarySearchTree sous contention, lectures
+//        d'ordre comprises
+//
+// 1. Chaque écrivain insère, supprime et cherche ses propres clés, mêlées
+//    à celles des autres : chaque résultat doit correspondre à l'exécution
+//    séquentielle de ce thread. Pendant ce temps, autant de lecteurs
+//    appellent rank et nth_element sur un bloc de clés négatives fixes,
+//    plus petites que toutes les autres : leurs positions ne changent
+//    jamais et doivent toujours être lues exactes.
+// 2. Tous les écrivains se disputent 64 clés, insérées et supprimées au
+//    hasard : les mêmes noeuds et compteurs sont modifiés de toutes parts.
+//
+// Après chaque phase, size() doit être le nombre de clés présentes selon
+// contains (celles attendues à la fin de la phase 1), et
+// rank(nth_element(i)) == i pour toute position, par ordre croissant :
+// une mise à jour de compteur perdue fausse ces rangs.
+//
+// @return vrai si aucune incohérence n'a été observée
+bool stressConcurrent(size_t threads, size_t ops) {
+    const size_t owned = 1024, shared = 64, fixed = 256;
+    ConcurrentBinarySearchTree<int> tree;
+    for (size_t j = 0; j < fixed; ++j) tree.insert(int(j) - int(fixed));
+    vector<vector<char>> present(threads, vector<char>(owned));
+    atomic<size_t> errors{0};
+    // nth_element lève logic_error si les compteurs sont faux
+    auto consistent = [&](size_t expected) {
+        if (tree.size() != expected) return false;
+        int prev = 0;
+        try {
+            for (size_t i = 0; i < expected; ++i) {
+                int key = tree.nth_element(i);
+                if ((i != 0 && !(prev < key)) || tree.rank(key) != i) return false;
+                prev = key;
+            }
+        } catch (const logic_error&) {
+            return false;
+        }
+        return true;
+    };
+
+    atomic<bool> done{false};
+    vector<thread> readers;
+    for (size_t t = 0; t < threads; ++t) {
+        readers.emplace_back([&, t] {
+            mt19937 gen(unsigned(200 + t));
+            while (!done.load(memory_order_relaxed)) {
+                size_t j = gen() % fixed;
+                int key = int(j) - int(fixed);
+                try {
+                    if (tree.rank(key) != j || tree.nth_element(j) != key) ++errors;
+                } catch (const logic_error&) {
+                    ++errors;
+                }
+            }
+        });
+    }
+    vector<thread> pool;
+    for (size_t t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t] {
+            mt19937 gen(static_cast<unsigned>(t));
+            for (size_t i = 0; i < ops; ++i) {
+                size_t k = gen() % owned;
+                int key = int(k * threads + t);
+                bool ok = true;
+                switch (gen() % 3) {
+                    case 0: tree.insert(key); present[t][k] = 1; break;
+                    case 1: ok = tree.deleteElement(key) == bool(present[t][k]); present[t][k] = 0; break;
+                    default: ok = tree.contains(key) == bool(present[t][k]);
+                }
+                if (!ok) ++errors;
+            }
+        });
+    }
+    for (thread& th : pool) th.join();
+    done = true;
+    for (thread& th : readers) th.join();
+    size_t expected = fixed;
+    for (size_t t = 0; t < threads; ++t) {
+        for (size_t k = 0; k < owned; ++k) {
+            if (tree.contains(int(k * threads + t)) != bool(present[t][k])) ++errors;
+            expected += present[t][k];
+        }
+    }
+    if (!consistent(expected)) ++errors;
+
+    // clés au-delà de celles de la première phase
+    const int base = int(owned * threads);
+    pool.clear();
+    for (size_t t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t] {
+            mt19937 gen(unsigned(100 + t));
+            for (size_t i = 0; i < ops; ++i) {
+                int key = base + int(gen() % shared);
+                if (gen() % 2) {
+                    tree.insert(key);
+                } else {
+                    tree.deleteElement(key);
+                }
+            }
+        });
+    }
+    for (thread& th : pool) th.join();
+    for (size_t k = 0; k < shared; ++k) expected += tree.contains(base + int(k));
+    if (!consistent(expected)) ++errors;
+    return errors == 0;
+}
+
+//
+// @brief arbre concurrent : test sous contention, puis débit contre un
+//        arbre sous verrou global, pour des mélanges lectures / écritures
+//        100/0, 95/5 et 50/50
+//
+void benchConcurrent(size_t n) {
+    vector<int> keys = makeKeys("random", n);
+    size_t hw = max<size_t>(thread::hardware_concurrency(), 1);
+    printf("concurrent: %zu coeur(s) disponible(s)\n", hw);
+    for (size_t threads : {size_t(2), max<size_t>(hw, 4)}) {
+        printf("concurrent stress threads=%zu: %s\n", threads,
+               stressConcurrent(threads, 200000) ? "ok" : "FAILED");
+    }
+    for (unsigned writes : {0u, 5u, 50u}) {
+        vector<size_t> counts = {1, 2, 4};
+        if (hw > 4) counts.push_back(hw);
+        for (size_t threads : counts) {
+            LockedTree locked;
+            ConcurrentBinarySearchTree<int> shared;
+            // clés paires : les écritures insèrent les impaires et retirent
+            // les paires, la taille reste proche de n (toujours > n / 2)
+            for (int k : keys) {
+                locked.insert(2 * k);
+                shared.insert(2 * k);
+            }
+            size_t ops = 1000000 / threads;
+            double a = throughput(locked, n, threads, writes, ops);
+            double b = throughput(shared, n, threads, writes, ops);
+            printf("concurrent %3u%% writes threads=%-3zu n=%-9zu "
+                   "locked %7.2f  concurrent %7.2f  (Mops/s)\n",
+                   writes, threads, n, a, b);
+        }
+    }
+}
+
+//
+// @brief Test de linéarisabilité de LockFreeBinarySearchTree sous
+//        contention
+//
+// 1. Chaque thread insère, supprime et cherche ses propres clés, mêlées à
+//    celles des autres dans l'arbre : chaque résultat doit correspondre à
+//    l'exécution séquentielle de ce thread, et l'arbre final à l'union.
+// 2. Tous les threads se disputent 64 clés : pour chaque clé, insertions
+//    réussies moins suppressions réussies doit valoir 1 si elle est
+//    présente à la fin, 0 sinon.
+//
+// @return vrai si aucune incohérence n'a été observée
+bool stressLockFree(size_t threads, size_t ops) {
+    const size_t owned = 1024, shared = 64;
+    LockFreeBinarySearchTree<int> tree;
+    vector<vector<char>> present(threads, vector<char>(owned));
+    atomic<size_t> errors{0};
+    vector<thread> pool;
+    for (size_t t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t] {
+            mt19937 gen(static_cast<unsigned>(t));
+            for (size_t i = 0; i < ops; ++i) {
+                size_t k = gen() % owned;
+                int key = int(k * threads + t);
+                bool ok;
+                switch (gen() % 3) {
+                    case 0: ok = tree.insert(key) == !present[t][k]; present[t][k] = 1; break;
+                    case 1: ok = tree.deleteElement(key) == bool(present[t][k]); present[t][k] = 0; break;
+                    default: ok = tree.contains(key) == bool(present[t][k]);
+                }
+                if (!ok) ++errors;
+            }
+        });
+    }
+    for (thread& th : pool) th.join();
+    for (size_t t = 0; t < threads; ++t) {
+        for (size_t k = 0; k < owned; ++k) {
+            if (tree.contains(int(k * threads + t)) != bool(present[t][k])) ++errors;
+        }
+    }
+
+    // clés négatives, disjointes de la première phase
+    vector<vector<long>> balance(threads, vector<long>(shared));
+    pool.clear();
+    for (size_t t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t] {
+            mt19937 gen(unsigned(100 + t));
+            for (size_t i = 0; i < ops; ++i) {
+                size_t k = gen() % shared;
+                int key = -1 - int(k);
+                if (gen() % 2) {
+                    balance[t][k] += tree.insert(key);
+                } else {
+                    balance[t][k] -= tree.deleteElement(key);
+                }
+            }
+        });
+    }
+    for (thread& th : pool) th.join();
+    for (size_t k = 0; k < shared; ++k) {
+        long b = 0;
+        for (size_t t = 0; t < threads; ++t) b += balance[t][k];
+        if (b != long(tree.contains(-1 - int(k)))) ++errors;
+    }
+    return errors == 0;
+}
+
+//
+// @brief p50 / p99 / p999 des latences de chaque opération (contains ou
+//        écriture) de threads concurrents, en nanosecondes
+//
+template<typename Tree>
+void latencies(const char* name, Tree& tree, size_t n, size_t threads,
+               unsigned writePercent, size_t opsPerThread) {
+    vector<vector<float>> samples(threads, vector<float>(opsPerThread));
+    vector<thread> pool;
+    for (size_t t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t] {
+            mt19937 gen(unsigned(31 + t));
+            size_t acc = 0;
+            for (float& sample : samples[t]) {
+                int key = int(gen() % (2 * n));
+                bool write = gen() % 100 < writePercent;
+                auto start = Clock::now();
+                if (!write) {
+                    acc += tree.contains(key);
+                } else if (key & 1) {
+                    tree.insert(key);
+                } else {
+                    tree.deleteElement(key);
+                }
+                sample = float(chrono::duration<double, nano>(Clock::now() - start).count());
+            }
+            sink = acc;
+        });
+    }
+    for (thread& th : pool) th.join();
+
+    vector<float> all;
+    for (const vector<float>& v : samples) all.insert(all.end(), v.begin(), v.end());
+    auto at = [&](double q) {
+        auto it = all.begin() + ptrdiff_t(q * double(all.size() - 1));
+        nth_element(all.begin(), it, all.end());
+        return double(*it);
+    };
+    double p50 = at(0.5), p99 = at(0.99), p999 = at(0.999);
+    printf("lockfree %-8s %3u%% writes threads=%-3zu n=%-9zu "
+           "p50 %8.0f  p99 %8.0f  p999 %9.0f  (ns)\n",
+           name, writePercent, threads, n, p50, p99, p999);
+}
+
+//
+// @brief arbre sans verrou : test de linéarisabilité, puis latences contre
+//        un BinarySearchTree sous verrou global
+//
+void benchLockFree(size_t n) {
+    size_t hw = max<size_t>(thread::hardware_concurrency(), 1);
+    for (size_t threads : {size_t(2), max<size_t>(hw, 4)}) {
+        printf("lockfree stress threads=%zu: %s\n", threads,
+               stressLockFree(threads, 200000) ? "ok" : "FAILED");
+    }
+
+    vector<int> keys = makeKeys("random", n);
+    vector<size_t> counts = {1, 4, 16};
+    if (hw > 16) counts.push_back(hw);
+    for (unsigned writes : {5u, 50u}) {
+        for (size_t threads : counts) {
+            LockedTree locked;
+            LockFreeBinarySearchTree<int> lockFree;
+            for (int k : keys) {
+                locked.insert(2 * k);
+                lockFree.insert(2 * k);
+            }
+            size_t ops = 1000000 / threads;
+            latencies("locked", locked, n, threads, writes, ops);
+            latencies("lockfree", lockFree, n, threads, writes, ops);
+        }
+    }
+}
+
+//
+// @brief mémoire résidente du processus en octets, 0 si inconnue
+//
+size_t residentBytes() {
+#if defined(__linux__)
+    size_t pages = 0, resident = 0;
+    if (FILE* f = fopen("/proc/self/statm", "r")) {
+        if (fscanf(f, "%zu %zu", &pages, &resident) != 2) resident = 0;
+        fclose(f);
+    }
+    return resident * size_t(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+//
+// @brief arbre persistant : coût d'un instantané contre une copie
+//        profonde, coût d'une mise à jour, et mémoire ajoutée par version
+//        quand toutes les versions sont conservées
+//
+void benchPersistent(size_t n) {
+    vector<int> keys = makeKeys("random", n);
+    using Mutable = BinarySearchTree<int, NoTrace, WeightBalanced>;
+    Mutable tree;
+    PersistentBinarySearchTree<int> persistent;
+    double insert = nsPerOp(n, [&] {
+        for (int k : keys) tree.insert(2 * k);
+    });
+    double insertPersistent = nsPerOp(n, [&] {
+        for (int k : keys) persistent.insert(2 * k);
+    });
+    double copy = nsPerOp(1, [&] {
+        Mutable clone(tree);
+        sink = clone.size();
+    });
+    const size_t reps = 1000000;
+    double snapshot = nsPerOp(reps, [&] {
+        size_t acc = 0;
+        for (size_t i = 0; i < reps; ++i) acc += persistent.snapshot().size();
+        sink = acc;
+    });
+    printf("persistent n=%-9zu insert %7.1f / %7.1f (mutable / persistent)  "
+           "copy %12.1f  snapshot %5.1f  (ns/op)\n",
+           n, insert, insertPersistent, copy, snapshot);
+
+    // une version conservée après chaque mise à jour
+    const size_t versions = 100000;
+    vector<PersistentBinarySearchTree<int>> history;
+    history.reserve(versions);
+    mt19937 gen(3);
+    size_t before = residentBytes();
+    double update = nsPerOp(versions, [&] {
+        for (size_t i = 0; i < versions; ++i) {
+            int key = int(gen() % (2 * n));
+            if (key & 1) persistent.insert(key); else persistent.deleteElement(key);
+            history.push_back(persistent.snapshot());
+        }
+    });
+    size_t after = residentBytes();
+    double rank = nsPerOp(versions, [&] {
+        size_t acc = 0;
+        for (size_t i = 0; i < versions; ++i)
+            acc += history[i].rank(history[i].nth_element(i % n / 2));
+        sink = acc;
+    });
+    printf("persistent n=%-9zu versions=%zu  update+snapshot %7.1f ns  "
+           "%7.1f bytes/version  rank(nth_element) on old versions %7.1f ns\n",
+           n, versions, update, double(after - before) / double(versions), rank);
+}
+
+//
+// @brief parcours et équilibrage séquentiels contre parallèles, sur un
+//        arbre construit par insertions aléatoires
+//
+void benchParallel(size_t n) {
+    vector<int> keys = makeKeys("random", n);
+    size_t hw = max<size_t>(thread::hardware_concurrency(), 1);
+    vector<size_t> counts = {1, 4};
+    if (hw > 4) counts.push_back(hw);
+    for (size_t threads : counts) {
+        BinarySearchTree<int> tree;
+        for (int k : keys) tree.insert(k);
+        double sym = nsPerOp(1, [&] {
+            size_t acc = 0;
+            tree.visitSym([&](int k) { acc += size_t(k); });
+            sink = acc;
+        });
+        atomic<size_t> total{0};
+        double unordered = nsPerOp(1, [&] {
+            tree.parallel_for_each([&](int k) {
+                total.fetch_add(size_t(k), memory_order_relaxed);
+            }, threads);
+        });
+        vector<int> out(n);
+        double ordered = nsPerOp(1, [&] {
+            tree.parallel_for_each_ordered([&](size_t pos, int k) { out[pos] = k; },
+                                           threads);
+        });
+        BinarySearchTree<int> other;
+        for (int k : keys) other.insert(k);
+        double balance = nsPerOp(1, [&] { tree.balance(); });
+        double parallel = nsPerOp(1, [&] { other.parallel_balance(threads); });
+        printf("parallel threads=%-3zu n=%-9zu visitSym %7.1f  for_each %7.1f  "
+               "for_each_ordered %7.1f  balance %7.1f  parallel_balance %7.1f  (ms)\n",
+               threads, n, sym / 1e6, unordered / 1e6, ordered / 1e6,
+               balance / 1e6, parallel / 1e6);
+    }
+}
+
+//
+// @brief redémarrage : réinsertion des clés d'un fichier, load() et map(),
+//        temps jusqu'à la première requête et mémoire résidente ajoutée
+//
+void benchSaveLoad(size_t n) {
+    const char* path = "bench_tree.bin";
+    vector<int> keys = makeKeys("random", n);
+    vector<int> probes(100000);
+    mt19937 gen(5);
+    for (int& p : probes) p = int(gen() % n);
+    using Tree = BinarySearchTree<int, NoTrace, WeightBalanced>;
+    // gardé en vie : sa mémoire libérée fausserait les mesures suivantes
+    Tree tree(keys.begin(), keys.end());
+    double save = nsPerOp(1, [&] { tree.save(path); });
+    printf("saveload n=%-9zu save          %9.1f ms\n", n, save / 1e6);
+    auto report = [&](const char* name, double ns, size_t before, auto& tree) {
+        double lookup = nsPerOp(probes.size(), [&] {
+            size_t found = 0;
+            for (int k : probes) found += tree.contains(k);
+            sink = found;
+        });
+        printf("saveload n=%-9zu %-13s %9.1f ms  rss %+8.1f MB  "
+               "then contains %7.1f ns\n", n, name, ns / 1e6,
+               double(residentBytes() - before) / 1e6, lookup);
+    };
+
+    size_t before = residentBytes();
+    FrozenTree<int> mapped;
+    double map = nsPerOp(1, [&] { mapped = Tree::map(path); });
+    report("map", map, before, mapped);
+
+    before = residentBytes();
+    Tree loaded;
+    double load = nsPerOp(1, [&] { loaded.load(path); });
+    report("load", load, before, loaded);
+
+    before = residentBytes();
+    Tree reinserted;
+    double reinsert = nsPerOp(1, [&] {
+        FrozenTree<int> file = Tree::map(path);
+        for (size_t i = 0; i < file.size(); ++i) reinserted.insert(file.nth_element(i));
+    });
+    report("reinsert", reinsert, before, reinserted);
+    remove(path);
+}
+
+//
+// @brief Test aléatoire de split, join et des opérations ensemblistes
+//        d'un arbre WeightBalanced contre std::set
+//
+// Chaque tour modifie un peu l'arbre, le coupe à une clé tirée au hasard
+// puis recolle les deux moitiés, y joint un arbre de clés plus grandes,
+// vérifie que join refuse des clés qui se chevauchent, et lui applique
+// union_with, intersect_with ou difference_with avec un second arbre
+// aléatoire. Après chaque opération, les clés doivent être celles de la
+// référence et valid() doit tenir : ordre, compteurs et critère de poids.
+//
+// @return vrai si aucune incohérence n'a été observée
+bool checkSetOps(size_t rounds) {
+    using Tree = BinarySearchTree<int, NoTrace, WeightBalanced>;
+    mt19937 gen(21);
+    Tree tree;
+    set<int> ref;
+    size_t errors = 0;
+    auto same = [](const Tree& t, const set<int>& s) {
+        return t.valid() && t.size() == s.size() &&
+               equal(t.begin(), t.end(), s.begin(), s.end());
+    };
+    for (size_t i = 0; i < rounds; ++i) {
+        const int range = 1 + int(gen() % 4000);
+        for (size_t k = gen() % 64; k > 0; --k) {
+            int key = int(gen() % unsigned(range));
+            if (gen() % 4 != 0) {
+                tree.insert(key);
+                ref.insert(key);
+            } else {
+                tree.deleteElement(key);
+                ref.erase(key);
+            }
+        }
+
+        int cut = int(gen() % unsigned(range + 2)) - 1;
+        Tree right = tree.split(cut);
+        if (!same(tree, set<int>(ref.begin(), ref.lower_bound(cut))) ||
+            !same(right, set<int>(ref.lower_bound(cut), ref.end()))) ++errors;
+        tree.join(std::move(right));
+        if (!same(tree, ref) || right.size() != 0) ++errors;
+
+        // clés plus grandes, en nombre sans rapport avec la taille de l'arbre
+        Tree above;
+        int base = ref.empty() ? 0 : *ref.rbegin() + 1;
+        for (size_t k = gen() % (gen() % 2 ? 8 : 2048); k > 0; --k) {
+            int key = base + int(gen() % 4096);
+            above.insert(key);
+            ref.insert(key);
+        }
+        tree.join(std::move(above));
+        if (!same(tree, ref)) ++errors;
+
+        if (ref.size() > 1) {
+            Tree overlap;
+            overlap.insert(*ref.begin());
+            try {
+                tree.join(std::move(overlap));
+                ++errors;
+            } catch (const logic_error&) {
+                if (!same(tree, ref) || overlap.size() != 1) ++errors;
+            }
+        }
+
+        Tree other;
+        set<int> refOther;
+        int hi = ref.empty() ? range : *ref.rbegin() + 2;
+        for (size_t k = gen() % (ref.size() + 16); k > 0; --k) {
+            int key = int(gen() % unsigned(hi));
+            other.insert(key);
+            refOther.insert(key);
+        }
+        switch (gen() % 3) {
+            case 0:
+                tree.union_with(other);
+                ref.insert(refOther.begin(), refOther.end());
+                break;
+            case 1: {
+                tree.intersect_with(other);
+                set<int> kept;
+                for (int k : ref) if (refOther.count(k)) kept.insert(k);
+                ref.swap(kept);
+                break;
+            }
+            default:
+                tree.difference_with(other);
+                for (int k : refOther) ref.erase(k);
+        }
+        if (!same(tree, ref)) ++errors;
+    }
+    return errors == 0;
+}
+
+//
+// @brief union, intersection et différence par split/join contre la boucle
+//        contains / insert / deleteElement, pour des rapports de tailles
+//        1:1, 1:100 et 1:10000
+//
+void benchSetOps(size_t n) {
+    printf("setops check split/join: %s\n", checkSetOps(2000) ? "ok" : "FAILED");
+    using Tree = BinarySearchTree<int, NoTrace, WeightBalanced>;
+    mt19937 gen(9);
+    const int range = int(2 * n);
+    Tree big;
+    for (size_t i = 0; i < n; ++i) big.insert(int(gen() % range));
+    for (size_t ratio : {1, 100, 10000}) {
+        Tree small;
+        for (size_t i = 0; i < n / ratio; ++i) small.insert(int(gen() % range));
+        auto measure = [&](auto op) {
+            Tree copy(big);
+            return nsPerOp(1, [&] { op(copy); });
+        };
+        double naive[3] = {
+            measure([&](Tree& t) {
+                for (int k : small) if (!t.contains(k)) t.insert(k);
+            }),
+            measure([&](Tree& t) {
+                vector<int> gone;
+                for (int k : t) if (!small.contains(k)) gone.push_back(k);
+                for (int k : gone) t.deleteElement(k);
+            }),
+            measure([&](Tree& t) {
+                for (int k : small) t.deleteElement(k);
+            }),
+        };
+        for (size_t threads : {size_t(1), size_t(0)}) {
+            double fast[3] = {
+                measure([&](Tree& t) { t.union_with(small, threads); }),
+                measure([&](Tree& t) { t.intersect_with(small, threads); }),
+                measure([&](Tree& t) { t.difference_with(small, threads); }),
+            };
+            printf("setops n=%-8zu m=%-8zu threads=%-2zu union %8.2f/%8.2f  "
+                   "intersect %8.2f/%8.2f  difference %8.2f/%8.2f  (ms, naive/split-join)\n",
+                   big.size(), small.size(), (threads ? threads : size_t(max(thread::hardware_concurrency(), 1u))),
+                   naive[0] / 1e6, fast[0] / 1e6, naive[1] / 1e6, fast[1] / 1e6,
+                   naive[2] / 1e6, fast[2] / 1e6);
+        }
+    }
+}
+
+//
+// @brief requêtes et suppressions par intervalle : parcours filtré et
+//        deleteMin répétés contre for_each_in_range et erase_range
+//
+void benchRange(size_t n) {
+    using Tree = BinarySearchTree<int, NoTrace, WeightBalanced>;
+    vector<int> keys = makeKeys("random", n);
+    Tree tree(keys.begin(), keys.end());
+    const size_t width = 1000;
+    const size_t queries = 100;
+    vector<int> starts(queries);
+    mt19937 gen(11);
+    for (int& lo : starts) lo = int(gen() % (n - width));
+
+    double filtered = nsPerOp(queries, [&] {
+        size_t acc = 0;
+        for (int lo : starts) {
+            int hi = lo + int(width);
+            tree.visitSym([&](int k) { if (lo <= k && k < hi) acc += size_t(k); });
+        }
+        sink = acc;
+    });
+    double ranged = nsPerOp(queries, [&] {
+        size_t acc = 0;
+        for (int lo : starts) {
+            tree.for_each_in_range(lo, lo + int(width), [&](int k) { acc += size_t(k); });
+        }
+        sink = acc;
+    });
+    printf("range n=%-9zu width=%-6zu visitSym+filtre %10.1f  for_each_in_range %8.1f  "
+           "(us/requête)\n", n, width, filtered / 1e3, ranged / 1e3);
+
+    // "supprimer tout ce qui est plus ancien que X" : le premier dixième
+    const size_t drop = n / 10;
+    auto measure = [&](auto op) {
+        Tree copy(tree);
+        return nsPerOp(1, [&] { op(copy); });
+    };
+    double research = measure([&](Tree& t) {
+        for (size_t i = 0; i < drop; ++i) {
+            int k = t.min();
+            t.deleteElement(k);
+        }
+    });
+    double direct = measure([&](Tree& t) {
+        for (size_t i = 0; i < drop; ++i) t.deleteMin();
+    });
+    double bulk = measure([&](Tree& t) {
+        sink = t.erase_range(0, int(drop));
+    });
+    printf("range n=%-9zu drop=%-8zu min+deleteElement %8.2f  deleteMin %8.2f  "
+           "erase_range %8.2f  (ms)\n", n, drop, research / 1e6, direct / 1e6, bulk / 1e6);
+}
+
+//
+// @brief coût des statistiques : insert et contains sans politique de
+//        statistiques et avec TreeStats, puis coût d'un instantané
+//
+// Les deux arbres restent vivants jusqu'à la fin : le second ne réutilise
+// pas la mémoire libérée du premier, ce qui fausserait la comparaison.
+//
+template<typename Tree>
+void benchStatsTree(const char* name, Tree& tree, const vector<int>& keys,
+                    const vector<int>& probes) {
+    double insert = nsPerOp(keys.size(), [&] {
+        for (int k : keys) tree.insert(k);
+    });
+    double contains = nsPerOp(probes.size(), [&] {
+        size_t acc = 0;
+        for (int k : probes) acc += tree.contains(k);
+        sink = acc;
+    });
+    TreeStatsSnapshot snapshot;
+    double stats = nsPerOp(1, [&] { snapshot = tree.stats(); });
+    printf("stats %-9s n=%-9zu insert %7.1f  contains %7.1f  (ns/op)  stats() %7.2f ms  "
+           "hauteur %zu/%zu\n", name, keys.size(), insert, contains, stats / 1e6,
+           snapshot.height, snapshot.optimalHeight);
+}
+
+void benchStats(size_t n) {
+    vector<int> keys = makeKeys("random", n);
+    vector<int> probes = keys;
+    shuffle(probes.begin(), probes.end(), mt19937(3));
+    BinarySearchTree<int> plain;
+    BinarySearchTree<int, NoTrace, NoBalance, NewAllocator, TreeStats> counted;
+    benchStatsTree("NoStats", plain, keys, probes);
+    benchStatsTree("TreeStats", counted, keys, probes);
+}
+
+//
+// @brief Test aléatoire du majorant de hauteur d'AutoRebalance contre
+//        std::set
+//
+// Chaque tour applique à un arbre AutoRebalance, différé ou non, une
+// opération tirée au hasard : insert isolé, suite d'insert triés qui
+// allonge une branche, deleteElement, insert_batch, erase_batch,
+// balance_step avec un petit budget ou maintain(). Après chaque
+// opération, les clés doivent être celles de la référence et valid()
+// doit tenir, donc en particulier height() <= heightBound().
+//
+// @return vrai si aucune incohérence n'a été observée
+bool checkAutoRebalance(size_t rounds) {
+    using Tree = BinarySearchTree<int, NoTrace, AutoRebalance>;
+    mt19937 gen(23);
+    size_t errors = 0;
+    for (bool deferred : {true, false}) {
+        for (double factor : {1.5, 2.0, 4.0}) {
+            Tree tree{AutoRebalance(factor, 0, deferred)};
+            set<int> ref;
+            // une clé tirée au hasard, ou juste au-delà d'un bord de l'arbre :
+            // une branche collée à un bloc équilibré plus lourd est le cas
+            // où une rotation enfonce la branche
+            auto pick = [&](int range, bool below) {
+                if (ref.empty() || gen() % 2) return int(gen() % unsigned(range));
+                return below ? *ref.begin() - 1 : *ref.rbegin() + 1;
+            };
+            for (size_t i = 0; i < rounds; ++i) {
+                if (i % 256 == 0) { // repart d'un arbre vide, rebâti par les tours suivants
+                    tree.erase_batch(ref.begin(), ref.end());
+                    ref.clear();
+                }
+                const int range = 1 + int(gen() % 2000);
+                switch (gen() % 7) {
+                    case 0: {
+                        int key = int(gen() % unsigned(range));
+                        tree.insert(key);
+                        ref.insert(key);
+                        break;
+                    }
+                    case 1: { // insert triés : une branche
+                        bool below = gen() % 2;
+                        int key = pick(range, below);
+                        for (size_t k = gen() % 64; k > 0; --k, key += below ? -1 : 1) {
+                            tree.insert(key);
+                            ref.insert(key);
+                        }
+                        break;
+                    }
+                    case 2:
+                        for (size_t k = gen() % 8; k > 0; --k) {
+                            int key = int(gen() % unsigned(range));
+                            tree.deleteElement(key);
+                            ref.erase(key);
+                        }
+                        break;
+                    case 3: { // clés contiguës : un bloc équilibré
+                        bool below = gen() % 2;
+                        vector<int> batch(gen() % 128);
+                        int key = pick(range, below);
+                        for (int& k : batch) k = below ? key-- : key++;
+                        tree.insert_batch(batch.begin(), batch.end());
+                        ref.insert(batch.begin(), batch.end());
+                        break;
+                    }
+                    case 4: {
+                        vector<int> batch(gen() % 64);
+                        for (int& key : batch) key = int(gen() % unsigned(range));
+                        tree.erase_batch(batch.begin(), batch.end());
+                        for (int key : batch) ref.erase(key);
+                        break;
+                    }
+                    case 5:
+                        tree.balance_step(1 + gen() % 16);
+                        break;
+                    default:
+                        if (gen() % 4 == 0) tree.maintain();
+                }
+                if (!tree.valid() || tree.size() != ref.size() ||
+                    !equal(tree.begin(), tree.end(), ref.begin(), ref.end())) ++errors;
+            }
+        }
+    }
+    return errors == 0;
+}
+
+//
+// @brief chargement puis lectures : insert sur un flux de clés, avec un
+//        appel de maintain() toutes les 4096 insertions comme le ferait
+//        une boucle de maintenance, ou insert_batch par lots de 4096 clés,
+//        puis contains sur toutes les clés
+//
+template<typename Tree>
+void benchAutoTree(const char* name, const string& order, Tree& tree,
+                   const vector<int>& keys, const vector<int>& probes,
+                   bool batch = false) {
+    size_t balances = 0;
+    double insert = nsPerOp(keys.size(), [&] {
+        if (batch) {
+            for (size_t i = 0; i < keys.size(); i += 4096)
+                tree.insert_batch(keys.begin() + i,
+                                  keys.begin() + std::min(keys.size(), i + 4096));
+        } else {
+            for (size_t i = 0; i < keys.size(); ++i) {
+                tree.insert(keys[i]);
+                if (i % 4096 == 4095) balances += tree.maintain();
+            }
+        }
+        balances += tree.maintain();
+    });
+    double contains = nsPerOp(probes.size(), [&] {
+        size_t acc = 0;
+        for (int k : probes) acc += tree.contains(k);
+        sink = acc;
+    });
+    printf("autobalance %-10s %-6s n=%-8zu insert %8.1f  contains %7.1f  (ns/op)  "
+           "hauteur %-3zu maintain() %zu\n", name, order.c_str(), keys.size(), insert,
+           contains, tree.height(), balances);
+}
+
+void benchAutoBalance(size_t n) {
+    printf("autobalance check heightBound: %s\n",
+           checkAutoRebalance(20000) ? "ok" : "FAILED");
+    for (const string order : {"sorted", "random"}) {
+        vector<int> keys = makeKeys(order, n);
+        vector<int> probes = makeKeys("random", n);
+        BinarySearchTree<int, NoTrace, WeightBalanced> weight;
+        BinarySearchTree<int, NoTrace, AutoRebalance> inline_;
+        BinarySearchTree<int, NoTrace, AutoRebalance> deferred(AutoRebalance(4, 0, true));
+        benchAutoTree("WeightBal.", order, weight, keys, probes);
+        benchAutoTree("Auto", order, inline_, keys, probes);
+        benchAutoTree("Auto+maint", order, deferred, keys, probes);
+        BinarySearchTree<int, NoTrace, AutoRebalance> batched;
+        benchAutoTree("Auto+batch", order, batched, keys, probes, true);
+        if (order == "random") {
+            BinarySearchTree<int> plain;
+            benchAutoTree("NoBalance", order, plain, keys, probes);
+        }
+    }
+}
+
+//
+// @brief clé avec une charge utile ignorée par les comparaisons : la
+//        seule façon de l'associer à une clé dans BinarySearchTree
+//
+struct Payload {
+    int key;
+    int value;
+
+    bool operator<(const Payload& o) const noexcept { return key < o.key; }
+    bool operator>(const Payload& o) const noexcept { return key > o.key; }
+};
+
+//
+// @brief mise à jour de la valeur de clés présentes : deleteElement puis
+//        insert d'une clé avec charge utile, contre la modification en
+//        place de BinarySearchMap par find, operator[] et insert_or_assign
+//
+void benchMap(size_t n) {
+    vector<int> keys = makeKeys("random", n);
+    vector<int> probes = keys;
+    shuffle(probes.begin(), probes.end(), mt19937(5));
+    BinarySearchTree<Payload, NoTrace, WeightBalanced> tree;
+    BinarySearchMap<int, int> map;
+    for (int k : keys) {
+        tree.insert(Payload{k, 0});
+        map[k] = 0;
+    }
+    auto report = [&](const char* name, double ns) {
+        printf("map %-24s n=%-9zu %8.1f ns/op\n", name, n, ns);
+    };
+    report("tree erase+insert", nsPerOp(n, [&] {
+        for (int k : probes) {
+            tree.deleteElement(Payload{k, 0});
+            tree.insert(Payload{k, k});
+        }
+    }));
+    report("find()->value", nsPerOp(n, [&] {
+        for (int k : probes) map.find(k)->value = k;
+    }));
+    report("operator[]", nsPerOp(n, [&] {
+        for (int k : probes) map[k] += 1;
+    }));
+    report("insert_or_assign", nsPerOp(n, [&] {
+        for (int k : probes) map.insert_or_assign(k, k);
+    }));
+    size_t acc = 0;
+    report("rank+nth_element", nsPerOp(n, [&] {
+        for (int k : probes) acc += size_t(map.nth_element(map.rank(k)).value);
+    }));
+    sink = acc;
+}
+
+//
+// @brief histogramme de n mesures répétées (1000 valeurs distinctes) :
+//        insertion, percentiles et retrait d'une mesure, avec un
+//        multiensemble, avec un arbre de clés doublé d'une table de
+//        compteurs, et avec un noeud par mesure (paires valeur, numéro)
+//
+void benchMultiset(size_t n) {
+    const size_t distinct = 1000;
+    const size_t queries = 100000;
+    mt19937 gen(11);
+    vector<int> values(n);
+    for (int& v : values) v = int(gen() % distinct);
+
+    BinarySearchTree<int, NoTrace, WeightBalanced, NewAllocator, NoStats, Multiset> multi;
+    BinarySearchTree<int, NoTrace, WeightBalanced> keys;
+    BinarySearchMap<int, size_t> counts;
+    BinarySearchTree<pair<int, int>, NoTrace, WeightBalanced> pairs;
+
+    auto report = [&](const char* name, double insert, double percentile, double erase,
+                      size_t nodes) {
+        printf("multiset %-11s n=%-9zu insert %7.1f  percentile %9.1f  erase_one %7.1f  "
+               "(ns/op)  noeuds %zu\n", name, n, insert, percentile, erase, nodes);
+    };
+    size_t acc = 0;
+
+    double insert = nsPerOp(n, [&] {
+        for (int v : values) multi.insert(v);
+    });
+    double percentile = nsPerOp(queries, [&] {
+        for (size_t q = 0; q < queries; ++q) acc += size_t(multi.nth_element(q * n / queries));
+    });
+    double erase = nsPerOp(n / 2, [&] {
+        for (size_t i = 0; i < n / 2; ++i) multi.erase_one(values[i]);
+    });
+    report("Multiset", insert, percentile, erase, multi.stats().size);
+
+    insert = nsPerOp(n, [&] {
+        for (int v : values) {
+            keys.insert(v);
+            ++counts[v];
+        }
+    });
+    // sans rang pondéré, un percentile cumule les compteurs depuis le début
+    percentile = nsPerOp(queries, [&] {
+        for (size_t q = 0; q < queries; ++q) {
+            size_t target = q * n / queries, seen = 0;
+            for (const auto& e : counts) {
+                seen += e.value;
+                if (seen > target) {
+                    acc += size_t(e.key);
+                    break;
+                }
+            }
+        }
+    });
+    erase = nsPerOp(n / 2, [&] {
+        for (size_t i = 0; i < n / 2; ++i) {
+            size_t& c = counts[values[i]];
+            if (--c == 0) {
+                counts.erase(values[i]);
+                keys.deleteElement(values[i]);
+            }
+        }
+    });
+    report("cles+table", insert, percentile, erase, keys.size() + counts.size());
+
+    insert = nsPerOp(n, [&] {
+        for (size_t i = 0; i < n; ++i) pairs.insert({values[i], int(i)});
+    });
+    percentile = nsPerOp(queries, [&] {
+        for (size_t q = 0; q < queries; ++q) acc += size_t(pairs.nth_element(q * n / queries).first);
+    });
+    erase = nsPerOp(n / 2, [&] {
+        for (size_t i = 0; i < n / 2; ++i) pairs.deleteElement({values[i], int(i)});
+    });
+    report("paires", insert, percentile, erase, n);
+    sink = acc;
+}
+
+// Nombre d'allocations faites par les chaînes de benchStrings
+size_t stringAllocs = 0;
+
+//
+// @brief allocateur standard qui compte ses allocations dans stringAllocs
+//
+template<typename C>
+struct CountingAllocator {
+    using value_type = C;
+
+    CountingAllocator() = default;
+
+    template<typename U>
+    CountingAllocator(const CountingAllocator<U>&) noexcept {}
+
+    C* allocate(size_t n) {
+        ++stringAllocs;
+        return std::allocator<C>().allocate(n);
+    }
+
+    void deallocate(C* p, size_t n) noexcept {
+        std::allocator<C>().deallocate(p, n);
+    }
+
+    template<typename U>
+    bool operator==(const CountingAllocator<U>&) const noexcept { return true; }
+
+    template<typename U>
+    bool operator!=(const CountingAllocator<U>&) const noexcept { return false; }
+};
+
+//
+// @brief clés std::string trop longues pour l'optimisation des petites
+//        chaînes : copie contre déplacement à l'insertion, recherche par
+//        std::string construite contre string_view, insertion de doublons
+//        par insert contre emplace
+//
+void benchStrings(size_t n) {
+    using String = basic_string<char, char_traits<char>, CountingAllocator<char>>;
+    using Tree = BinarySearchTree<String, NoTrace, WeightBalanced>;
+    vector<String> keys;
+    keys.reserve(n);
+    char buffer[48];
+    for (int k : makeKeys("random", n)) {
+        snprintf(buffer, sizeof buffer, "cle-de-test-suffisamment-longue-%09d", k);
+        keys.emplace_back(buffer);
+    }
+    vector<string_view> views(keys.begin(), keys.end());
+
+    // nanosecondes et allocations de chaînes par opération
+    auto measure = [&](auto op) {
+        size_t before = stringAllocs;
+        double ns = nsPerOp(n, op);
+        return make_pair(ns, double(stringAllocs - before) / double(n));
+    };
+
+    Tree copied;
+    auto copy = measure([&] { for (const String& k : keys) copied.insert(k); });
+    vector<String> moving = keys;
+    Tree moved;
+    auto move = measure([&] { for (String& k : moving) moved.insert(std::move(k)); });
+    printf("strings n=%-9zu insert   copie %7.1f ns %4.2f alloc  "
+           "déplacement %7.1f ns %4.2f alloc\n",
+           n, copy.first, copy.second, move.first, move.second);
+
+    auto built = measure([&] {
+        size_t acc = 0;
+        for (string_view v : views) acc += copied.contains(String(v));
+        sink = acc;
+    });
+    auto view = measure([&] {
+        size_t acc = 0;
+        for (string_view v : views) acc += copied.contains(v);
+        sink = acc;
+    });
+    printf("strings n=%-9zu contains String %7.1f ns %4.2f alloc  "
+           "string_view %7.1f ns %4.2f alloc\n",
+           n, built.first, built.second, view.first, view.second);
+
+    auto insertDup = measure([&] { for (string_view v : views) copied.insert(String(v)); });
+    auto emplaceDup = measure([&] { for (string_view v : views) copied.emplace(v); });
+    printf("strings n=%-9zu doublons insert(String) %7.1f ns %4.2f alloc  "
+           "emplace(string_view) %7.1f ns %4.2f alloc\n",
+           n, insertDup.first, insertDup.second, emplaceDup.first, emplaceDup.second);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    string group = argc > 1 ? argv[1] : "all";
+    size_t n = argc > 2 ? stoul(argv[2]) : 0;
+
+    if (group == "all" || group == "balance") benchBalance(n ? n : 20000);
+    if (group == "all" || group == "incremental") benchIncremental(n ? n : 1000000);
+    if (group == "all" || group == "stress") benchStress(n ? n : 10000000);
+    if (group == "all" || group == "alloc") benchAlloc(n ? n : 10000000);
+    if (group == "all" || group == "iter") benchIter(n ? n : 1000000);
+    if (group == "all" || group == "copy") benchCopy(n ? n : 1000000);
+    if (group == "all" || group == "bulk") benchBulk(n ? n : 10000000);
+    if (group == "all" || group == "batch") benchBatch(n ? n : 1000000);
+    if (group == "all" || group == "rank") benchRank(n ? n : 1000000);
+    if (group == "all" || group == "frozen") benchFrozen(n ? n : 10000000);
+    if (group == "all" || group == "btree") benchWide(n ? n : 1000000);
+    if (group == "all" || group == "concurrent") benchConcurrent(n ? n : 1000000);
+    if (group == "all" || group == "lockfree") benchLockFree(n ? n : 1000000);
+    if (group == "all" || group == "persistent") benchPersistent(n ? n : 1000000);
+    if (group == "all" || group == "parallel") benchParallel(n ? n : 10000000);
+    if (group == "all" || group == "saveload") benchSaveLoad(n ? n : 10000000);
+    if (group == "all" || group == "setops") benchSetOps(n ? n : 1000000);
+    if (group == "all" || group == "range") benchRange(n ? n : 1000000);
+    if (group == "all" || group == "strings") benchStrings(n ? n : 1000000);
+    if (group == "all" || group == "stats") benchStats(n ? n : 1000000);
+    if (group == "all" || group == "autobalance") benchAutoBalance(n ? n : 100000);
+    if (group == "all" || group == "map") benchMap(n ? n : 1000000);
+    if (group == "all" || group == "multiset") benchMultiset(n ? n : 1000000);
+
+    return EXIT_SUCCESS;
+}
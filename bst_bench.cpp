@@ -0,0 +1,443 @@
+//
+//  Suite de benchmarks de BinarySearchTree
+//
+//  Chaque opération est mesurée pour chaque type de clé (int, uint64_t,
+//  std::string), chaque distribution (sorted, random, zipf) et chaque
+//  taille. Les résultats sont écrits au format JSON de Google Benchmark,
+//  ce qui permet de comparer deux versions avec compare.py.
+//
+//  Compilation : cmake -S . -B build && cmake --build build --target bst_bench
+//  Usage       : ./bst_bench [--benchmark_filter=<regex>]
+//                            [--benchmark_out=<fichier.json>]
+//                            [--benchmark_format=console|json]
+//                            [--benchmark_min_time=<secondes>]
+//                            [--sizes=1e3,1e4,1e5,1e6]
+//
+//  Les tailles vont jusqu'à 1e8 ; au-delà de 1e6, prévoir la mémoire
+//  (environ 50 octets par noeud, plus la clé).
+//
+
+#include <chrono>
+#include <ctime>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <random>
+#include <regex>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <thread>
+
+#include "abr.cpp"
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+// Accumulateur empêchant le compilateur d'éliminer les appels mesurés
+volatile size_t sink;
+
+/**
+ *  @brief Options de la ligne de commande, mêmes noms que Google Benchmark
+ */
+struct Options {
+    regex filter{".*"};
+    string out;                                // fichier JSON, vide si aucun
+    bool json = false;                         // JSON sur la sortie standard
+    double minTime = 0.1;                      // secondes mesurées au minimum
+    vector<size_t> sizes = {1000, 10000, 100000, 1000000};
+};
+
+/**
+ *  @brief Résultat d'un benchmark : temps moyen par opération
+ */
+struct Result {
+    string name;
+    size_t iterations;  // nombre total d'opérations mesurées
+    double realTime;    // ns par opération
+    double cpuTime;     // ns par opération
+};
+
+/**
+ *  @brief Tirage de rangs entre 0 et n-1 selon une loi de Zipf d'exposant s
+ *
+ *  Méthode de rejet-inversion (Hörmann et Derflinger, 1996) : O(1) en
+ *  mémoire et en temps moyen, quel que soit n.
+ */
+class ZipfGenerator {
+public:
+    ZipfGenerator(size_t n, double s) : _n(double(n)), _s(s) {
+        _hIntegralX1 = hIntegral(1.5) - 1;
+        _hIntegralN = hIntegral(_n + 0.5);
+        _threshold = 2 - hIntegralInverse(hIntegral(2.5) - h(2));
+    }
+
+    template<typename Gen>
+    size_t operator()(Gen& gen) {
+        uniform_real_distribution<double> uniform(0, 1);
+        for (;;) {
+            double u = _hIntegralN + uniform(gen) * (_hIntegralX1 - _hIntegralN);
+            double x = hIntegralInverse(u);
+            double k = std::floor(x + 0.5);
+            k = std::min(std::max(k, 1.0), _n);
+            if (k - x <= _threshold || u >= hIntegral(k + 0.5) - h(k)) {
+                return size_t(k) - 1;
+            }
+        }
+    }
+
+private:
+    double h(double x) const {
+        return std::exp(-_s * std::log(x));
+    }
+
+    double hIntegral(double x) const {
+        double logX = std::log(x);
+        return expm1Over((1 - _s) * logX) * logX;
+    }
+
+    double hIntegralInverse(double x) const {
+        double t = std::max(x * (1 - _s), -1.0);
+        return std::exp(log1pOver(t) * x);
+    }
+
+    // log(1+x)/x et (exp(x)-1)/x, prolongés par continuité en 0
+    static double log1pOver(double x) {
+        return std::abs(x) > 1e-8 ? std::log1p(x) / x
+                                  : 1 - x * (0.5 - x * (1.0 / 3 - 0.25 * x));
+    }
+
+    static double expm1Over(double x) {
+        return std::abs(x) > 1e-8 ? std::expm1(x) / x
+                                  : 1 + x * 0.5 * (1 + x / 3 * (1 + 0.25 * x));
+    }
+
+    double _n;
+    double _s;
+    double _hIntegralX1;
+    double _hIntegralN;
+    double _threshold;
+};
+
+//
+// @brief i-ème clé d'un type donné. Deux indices distincts donnent deux
+//        clés distinctes.
+//
+template<typename K>
+K makeKey(size_t i);
+
+template<>
+int makeKey<int>(size_t i) {
+    return int(i);
+}
+
+template<>
+uint64_t makeKey<uint64_t>(size_t i) { // splitmix64, bijective : clés étalées
+    uint64_t z = uint64_t(i) + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+template<>
+string makeKey<string>(size_t i) { // trop longue pour les petites chaînes
+    char buffer[32];
+    snprintf(buffer, sizeof buffer, "key-%012zu", i);
+    return buffer;
+}
+
+template<typename K>
+const char* keyName();
+
+template<>
+const char* keyName<int>() { return "int"; }
+
+template<>
+const char* keyName<uint64_t>() { return "uint64_t"; }
+
+template<>
+const char* keyName<string>() { return "string"; }
+
+//
+// @brief indices des opérations d'un flux de n opérations sur n clés
+//
+// @param dist "sorted" (croissants), "random" (permutation aléatoire) ou
+//             "zipf" (tirages selon Zipf(0.99), les rangs les plus
+//             fréquents étant dispersés dans l'ordre des clés)
+//
+vector<size_t> makeStream(const string& dist, size_t n) {
+    vector<size_t> stream(n);
+    if (dist == "zipf") {
+        mt19937_64 gen(7);
+        ZipfGenerator zipf(n, 0.99);
+        // multiplier par un nombre premier plus grand que n est une
+        // bijection modulo n : les rangs fréquents sont dispersés
+        const uint64_t prime = 2654435761u;
+        for (size_t& s : stream) s = size_t(uint64_t(zipf(gen)) * prime % n);
+        return stream;
+    }
+    for (size_t i = 0; i < n; ++i) stream[i] = i;
+    if (dist == "random") shuffle(stream.begin(), stream.end(), mt19937_64(42));
+    return stream;
+}
+
+/**
+ *  @brief Exécute et rapporte les benchmarks sélectionnés par les options
+ */
+class Runner {
+public:
+    explicit Runner(const Options& options) : _options(options) {}
+
+    //
+    // @brief mesure op si name passe le filtre
+    //
+    // @param ops   nombre d'opérations effectuées par un appel de op
+    // @param setup préparation non mesurée, appelée avant chaque op
+    // @param op    l'opération mesurée
+    //
+    // L'ensemble est répété jusqu'à cumuler minTime secondes mesurées.
+    //
+    template<typename Setup, typename Op>
+    void run(const string& name, size_t ops, Setup setup, Op op) {
+        if (!regex_search(name, _options.filter)) return;
+        double real = 0;
+        double cpu = 0;
+        size_t reps = 0;
+        do {
+            setup();
+            clock_t c0 = clock();
+            auto t0 = Clock::now();
+            op();
+            auto t1 = Clock::now();
+            clock_t c1 = clock();
+            real += chrono::duration<double, nano>(t1 - t0).count();
+            cpu += double(c1 - c0) * 1e9 / CLOCKS_PER_SEC;
+            ++reps;
+        } while (real < _options.minTime * 1e9);
+        double total = double(ops ? ops : 1) * double(reps);
+        _results.push_back({name, size_t(total), real / total, cpu / total});
+        if (!_options.json) {
+            const Result& r = _results.back();
+            printf("%-40s %12.1f ns %12.1f ns %12zu\n", r.name.c_str(), r.realTime,
+                   r.cpuTime, r.iterations);
+            fflush(stdout);
+        }
+    }
+
+    //
+    // @brief vrai si au moins un des noms passe le filtre
+    //
+    bool selectsAny(const vector<string>& names) const {
+        return any_of(names.begin(), names.end(), [&](const string& name) {
+            return regex_search(name, _options.filter);
+        });
+    }
+
+    const vector<Result>& results() const {
+        return _results;
+    }
+
+private:
+    const Options& _options;
+    vector<Result> _results;
+};
+
+//
+// @brief toutes les opérations pour un type de clé, une distribution et
+//        une taille
+//
+// L'arbre de référence est construit en insérant les n clés dans l'ordre
+// de la distribution (aléatoire pour zipf) ; les recherches, rangs et
+// suppressions suivent le flux de la distribution. La politique
+// WeightBalanced évite qu'une insertion triée ne dégénère en liste, ce qui
+// rendrait les grandes tailles inutilisables.
+//
+template<typename K>
+void benchKeys(Runner& runner, const string& dist, size_t n) {
+    using Tree = BinarySearchTree<K, NoTrace, WeightBalanced>;
+    const string suffix = string("/") + keyName<K>() + "/" + dist + "/" + to_string(n);
+    vector<string> names;
+    for (const char* op : {"insert", "contains", "rank", "nth_element", "deleteElement",
+                           "deleteMin", "balance", "linearize", "copy", "visitPre",
+                           "visitSym", "visitPost"}) {
+        names.push_back(op + suffix);
+    }
+    if (!runner.selectsAny(names)) return; // évite de construire l'arbre
+
+    vector<K> keys(n);
+    for (size_t i = 0; i < n; ++i) keys[i] = makeKey<K>(i);
+    sort(keys.begin(), keys.end()); // l'indice i est la i-ème clé
+    vector<size_t> stream = makeStream(dist, n);
+    vector<size_t> order = dist == "zipf" ? makeStream("random", n) : stream;
+
+    Tree reference;
+    for (size_t i : order) reference.insert(keys[i]);
+
+    Tree tree;
+    runner.run("insert" + suffix, n, [&] { tree = Tree(); }, [&] {
+        for (size_t i : stream) tree.insert(keys[i]);
+    });
+    tree = Tree();
+
+    runner.run("contains" + suffix, n, [] {}, [&] {
+        size_t acc = 0;
+        for (size_t i : stream) acc += reference.contains(keys[i]);
+        sink = acc;
+    });
+    runner.run("rank" + suffix, n, [] {}, [&] {
+        size_t acc = 0;
+        for (size_t i : stream) acc += reference.rank(keys[i]);
+        sink = acc;
+    });
+    runner.run("nth_element" + suffix, n, [] {}, [&] {
+        size_t acc = 0;
+        for (size_t i : stream) acc += reference.nth_element(i) < keys[n / 2];
+        sink = acc;
+    });
+    runner.run("deleteElement" + suffix, n, [&] { tree = reference; }, [&] {
+        for (size_t i : stream) tree.deleteElement(keys[i]);
+    });
+    runner.run("deleteMin" + suffix, n, [&] { tree = reference; }, [&] {
+        for (size_t i = 0; i < n; ++i) tree.deleteMin();
+    });
+    runner.run("balance" + suffix, n, [&] { tree = reference; }, [&] {
+        tree.balance();
+    });
+    runner.run("linearize" + suffix, n, [&] { tree = reference; }, [&] {
+        tree.linearize();
+    });
+    tree = Tree();
+    runner.run("copy" + suffix, n, [&] { tree = Tree(); }, [&] {
+        Tree copy(reference);
+        tree.swap(copy);
+    });
+    tree = Tree();
+
+    size_t acc = 0;
+    auto visit = [&](const K& k) { acc += k < keys[n / 2]; };
+    runner.run("visitPre" + suffix, n, [] {}, [&] { reference.visitPre(visit); });
+    runner.run("visitSym" + suffix, n, [] {}, [&] { reference.visitSym(visit); });
+    runner.run("visitPost" + suffix, n, [] {}, [&] { reference.visitPost(visit); });
+    sink = acc;
+}
+
+//
+// @brief échappe une chaîne pour JSON
+//
+string jsonString(const string& s) {
+    string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+//
+// @brief résultats au format JSON de Google Benchmark
+//
+void writeJson(ostream& out, const vector<Result>& results, const char* executable) {
+    time_t now = time(nullptr);
+    char date[64];
+    strftime(date, sizeof date, "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+#ifdef NDEBUG
+    const char* buildType = "release";
+#else
+    const char* buildType = "debug";
+#endif
+    out << "{\n  \"context\": {\n"
+        << "    \"date\": " << jsonString(date) << ",\n"
+        << "    \"executable\": " << jsonString(executable) << ",\n"
+        << "    \"num_cpus\": " << max(thread::hardware_concurrency(), 1u) << ",\n"
+        << "    \"library_build_type\": " << jsonString(buildType) << "\n"
+        << "  },\n  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        out << (i ? ",\n" : "\n")
+            << "    {\n"
+            << "      \"name\": " << jsonString(r.name) << ",\n"
+            << "      \"run_name\": " << jsonString(r.name) << ",\n"
+            << "      \"run_type\": \"iteration\",\n"
+            << "      \"repetitions\": 1,\n"
+            << "      \"repetition_index\": 0,\n"
+            << "      \"threads\": 1,\n"
+            << "      \"iterations\": " << r.iterations << ",\n"
+            << "      \"real_time\": " << r.realTime << ",\n"
+            << "      \"cpu_time\": " << r.cpuTime << ",\n"
+            << "      \"time_unit\": \"ns\",\n"
+            << "      \"items_per_second\": " << (r.realTime > 0 ? 1e9 / r.realTime : 0) << "\n"
+            << "    }";
+    }
+    out << "\n  ]\n}\n";
+}
+
+//
+// @brief lit les options ; une option inconnue est une erreur
+//
+Options parse(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        string key = arg.substr(0, eq);
+        string value = eq == string::npos ? "" : arg.substr(eq + 1);
+        if (key == "--benchmark_filter") {
+            options.filter = regex(value);
+        } else if (key == "--benchmark_out") {
+            options.out = value;
+        } else if (key == "--benchmark_format") {
+            options.json = value == "json";
+        } else if (key == "--benchmark_min_time") {
+            options.minTime = stod(value);
+        } else if (key == "--sizes") {
+            options.sizes.clear();
+            stringstream list(value);
+            for (string item; getline(list, item, ',');) {
+                options.sizes.push_back(size_t(stod(item)));
+            }
+        } else {
+            throw invalid_argument("option inconnue : " + arg);
+        }
+    }
+    return options;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        options = parse(argc, argv);
+    } catch (const exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    Runner runner(options);
+    if (!options.json) {
+        printf("%-40s %15s %15s %12s\n", "Benchmark", "Time", "CPU", "Iterations");
+    }
+    for (size_t n : options.sizes) {
+        for (const char* dist : {"sorted", "random", "zipf"}) {
+            benchKeys<int>(runner, dist, n);
+            benchKeys<uint64_t>(runner, dist, n);
+            benchKeys<string>(runner, dist, n);
+        }
+    }
+
+    if (options.json) writeJson(cout, runner.results(), argv[0]);
+    if (!options.out.empty()) {
+        ofstream out(options.out);
+        writeJson(out, runner.results(), argv[0]);
+        if (!out) {
+            fprintf(stderr, "écriture impossible : %s\n", options.out.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,746 @@
+//
+//  B-Tree
+//
+//  Arbre de recherche à noeuds larges, de même interface que
+//  BinarySearchTree (insert, contains, deleteElement, nth_element, rank,
+//  visitSym).
+//
+
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>
+#include <type_traits>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+/**
+ *  @brief Recherche à l'intérieur d'un noeud : nombre de clés strictement
+ *  plus petites que key parmi les n premières d'un tableau trié.
+ *
+ *  Version générique par recherche dichotomique. Les types arithmétiques
+ *  utilisent une boucle sans branchement, et int32_t, int64_t, float et
+ *  double une comparaison vectorielle (AVX2, sinon SSE) dont le masque
+ *  (movemask) est compté par popcount.
+ *
+ *  Les versions vectorielles lisent les clés par blocs complets : le
+ *  tableau doit contenir un multiple de 8 cases initialisées. Le chemin
+ *  AVX2, et SSE4.2 pour int64_t, ne sont compilés qu'avec le jeu
+ *  d'instructions correspondant : cmake -DABR_NATIVE=ON, ou -march=native.
+ */
+template<typename T, typename = void>
+struct NodeSearch {
+    static size_t countLess(const T* keys, size_t n, const T& key) {
+        return size_t(std::lower_bound(keys, keys + n, key) - keys);
+    }
+};
+
+template<typename T>
+struct NodeSearch<T, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+    static size_t countLess(const T* keys, size_t n, T key) noexcept {
+        size_t c = 0;
+        for (size_t i = 0; i < n; ++i) c += size_t(keys[i] < key);
+        return c;
+    }
+};
+
+//
+// @brief nombre de bits à 1
+//
+inline size_t popCount(uint64_t bits) noexcept {
+#if defined(__GNUC__)
+    return size_t(__builtin_popcountll(bits));
+#else
+    size_t c = 0;
+    for (; bits != 0; bits &= bits - 1) ++c;
+    return c;
+#endif
+}
+
+//
+// @brief compte les clés plus petites bloc par bloc
+//
+// @param lessMask renvoie, pour un bloc de Lanes clés, le masque des clés
+//                 plus petites que la clé cherchée
+//
+// @remark n <= 64
+template<size_t Lanes, typename T, typename Fn>
+size_t countLessBlocks(const T* keys, size_t n, Fn lessMask) noexcept {
+    uint64_t bits = 0;
+    for (size_t i = 0; i < n; i += Lanes) {
+        bits |= uint64_t(lessMask(keys + i)) << i;
+    }
+    uint64_t valid = n < 64 ? (uint64_t(1) << n) - 1 : ~uint64_t(0);
+    return popCount(bits & valid);
+}
+
+#if defined(__AVX2__)
+
+template<>
+struct NodeSearch<int32_t> {
+    static size_t countLess(const int32_t* keys, size_t n, int32_t key) noexcept {
+        const __m256i k = _mm256_set1_epi32(key);
+        return countLessBlocks<8>(keys, n, [k](const int32_t* p) {
+            __m256i v = _mm256_loadu_si256((const __m256i*) p);
+            return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(k, v)));
+        });
+    }
+};
+
+template<>
+struct NodeSearch<int64_t> {
+    static size_t countLess(const int64_t* keys, size_t n, int64_t key) noexcept {
+        const __m256i k = _mm256_set1_epi64x(key);
+        return countLessBlocks<4>(keys, n, [k](const int64_t* p) {
+            __m256i v = _mm256_loadu_si256((const __m256i*) p);
+            return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(k, v)));
+        });
+    }
+};
+
+template<>
+struct NodeSearch<float> {
+    static size_t countLess(const float* keys, size_t n, float key) noexcept {
+        const __m256 k = _mm256_set1_ps(key);
+        return countLessBlocks<8>(keys, n, [k](const float* p) {
+            return _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(p), k, _CMP_LT_OQ));
+        });
+    }
+};
+
+template<>
+struct NodeSearch<double> {
+    static size_t countLess(const double* keys, size_t n, double key) noexcept {
+        const __m256d k = _mm256_set1_pd(key);
+        return countLessBlocks<4>(keys, n, [k](const double* p) {
+            return _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(p), k, _CMP_LT_OQ));
+        });
+    }
+};
+
+#elif defined(__SSE2__)
+
+template<>
+struct NodeSearch<int32_t> {
+    static size_t countLess(const int32_t* keys, size_t n, int32_t key) noexcept {
+        const __m128i k = _mm_set1_epi32(key);
+        return countLessBlocks<4>(keys, n, [k](const int32_t* p) {
+            __m128i v = _mm_loadu_si128((const __m128i*) p);
+            return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(k, v)));
+        });
+    }
+};
+
+#if defined(__SSE4_2__)
+template<>
+struct NodeSearch<int64_t> {
+    static size_t countLess(const int64_t* keys, size_t n, int64_t key) noexcept {
+        const __m128i k = _mm_set1_epi64x(key);
+        return countLessBlocks<2>(keys, n, [k](const int64_t* p) {
+            __m128i v = _mm_loadu_si128((const __m128i*) p);
+            return _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(k, v)));
+        });
+    }
+};
+#endif
+
+template<>
+struct NodeSearch<float> {
+    static size_t countLess(const float* keys, size_t n, float key) noexcept {
+        const __m128 k = _mm_set1_ps(key);
+        return countLessBlocks<4>(keys, n, [k](const float* p) {
+            return _mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(p), k));
+        });
+    }
+};
+
+template<>
+struct NodeSearch<double> {
+    static size_t countLess(const double* keys, size_t n, double key) noexcept {
+        const __m128d k = _mm_set1_pd(key);
+        return countLessBlocks<2>(keys, n, [k](const double* p) {
+            return _mm_movemask_pd(_mm_cmplt_pd(_mm_loadu_pd(p), k));
+        });
+    }
+};
+
+#endif
+
+/**
+ *  @brief Arbre B+ à noeuds larges
+ *
+ *  Chaque noeud contient jusqu'à NodeKeys clés (feuille) ou NodeKeys fils
+ *  (noeud interne) : une descente touche log_{NodeKeys/2}(n) noeuds au
+ *  lieu de log_2(n), et la recherche dans un noeud se fait sur des clés
+ *  contiguës (voir NodeSearch).
+ *
+ *  Les clés sont toutes dans les feuilles, chaînées dans l'ordre croissant.
+ *  Dans un noeud interne, keys[i] sépare child[i] et child[i + 1] : les clés
+ *  de child[i] sont <= keys[i] < les clés de child[i + 1]. Chaque noeud
+ *  interne connaît aussi le nombre de clés sous chacun de ses fils, ce qui
+ *  donne rank et nth_element en une descente.
+ *
+ *  Tout noeud sauf la racine est au moins à moitié plein.
+ *
+ *  @tparam T        type des clés, constructible par défaut et copiable
+ *  @tparam NodeKeys capacité d'un noeud, multiple de 8 entre 16 et 64
+ */
+template<typename T, size_t NodeKeys = 32>
+class BTree {
+    static_assert(NodeKeys >= 16 && NodeKeys <= 64 && NodeKeys % 8 == 0,
+                  "NodeKeys doit etre un multiple de 8 entre 16 et 64");
+
+public:
+
+    using value_type = T;
+    using reference = T&;
+    using const_reference = const T&;
+
+private:
+    static constexpr size_t MinKeys = NodeKeys / 2;
+
+    // hauteur maximale : chaque niveau sous la racine multiplie le nombre
+    // de clés par au moins MinKeys >= 8
+    static constexpr size_t MaxDepth = 24;
+
+    /**
+     *  @brief En-tête commun aux feuilles et aux noeuds internes.
+     *
+     *  Une case de plus que la capacité permet d'insérer avant de scinder.
+     */
+    struct Node {
+        bool leaf;                      // feuille ou noeud interne
+        size_t count;                   // nombre de clés (feuille) ou de fils
+        value_type keys[NodeKeys + 1];  // clés triées, ou séparateurs
+
+        explicit Node(bool leaf) : leaf(leaf), count(0), keys() {}
+    };
+
+    struct Leaf : Node {
+        Leaf* next; // feuille suivante dans l'ordre croissant
+
+        Leaf() : Node(true), next(nullptr) {}
+    };
+
+    struct Inner : Node {
+        Node* child[NodeKeys + 1];   // count fils
+        size_t weight[NodeKeys + 1]; // nombre de clés sous chaque fils
+
+        Inner() : Node(false), child(), weight() {}
+    };
+
+    /**
+     *  @brief  Racine de l'arbre. nullptr si l'arbre est vide
+     */
+    Node* _root;
+
+    /**
+     *  @brief  Nombre de clés de l'arbre
+     */
+    size_t _size;
+
+    static Inner* inner(Node* n) noexcept {
+        return static_cast<Inner*>(n);
+    }
+
+    static Leaf* leaf(Node* n) noexcept {
+        return static_cast<Leaf*>(n);
+    }
+
+    //
+    // @brief nombre de clés strictement plus petites que key parmi les n
+    //        premières clés d'un noeud
+    //
+    static size_t countLess(const Node* n, size_t count, const_reference key) {
+        return NodeSearch<value_type>::countLess(n->keys, count, key);
+    }
+
+    //
+    // @brief fils d'un noeud interne dont le sous-arbre peut contenir key
+    //
+    static size_t route(const Node* n, const_reference key) {
+        return countLess(n, n->count - 1, key);
+    }
+
+    //
+    // @brief nombre de clés d'un sous-arbre
+    //
+    // @remark O(NodeKeys)
+    static size_t weightOf(Node* n) noexcept {
+        if (n->leaf) return n->count;
+        size_t w = 0;
+        for (size_t i = 0; i < n->count; ++i) w += inner(n)->weight[i];
+        return w;
+    }
+
+    //
+    // @brief libère un noeud, feuille ou interne
+    //
+    static void freeNode(Node* n) noexcept {
+        if (n->leaf) {
+            delete leaf(n);
+        } else {
+            delete inner(n);
+        }
+    }
+
+    //
+    // @brief libère un sous-arbre
+    //
+    // @remark O(n), récursion de profondeur O(log(n))
+    static void freeAll(Node* n) noexcept {
+        if (n == nullptr) return;
+        if (!n->leaf) {
+            for (size_t i = 0; i < n->count; ++i) freeAll(inner(n)->child[i]);
+        }
+        freeNode(n);
+    }
+
+    //
+    // @brief décale les cases [pos, count) d'un tableau d'une case à droite
+    //        et écrit value en pos
+    //
+    template<typename U>
+    static void insertAt(U* a, size_t count, size_t pos, const U& value) {
+        std::copy_backward(a + pos, a + count, a + count + 1);
+        a[pos] = value;
+    }
+
+    //
+    // @brief retire la case pos d'un tableau de count cases
+    //
+    template<typename U>
+    static void eraseAt(U* a, size_t count, size_t pos) {
+        std::copy(a + pos + 1, a + count, a + pos);
+    }
+
+public:
+    //
+    // @brief Constructeur par défaut. Construit un arbre vide
+    //
+    BTree() noexcept : _root(nullptr), _size(0) {}
+
+    BTree(const BTree&) = delete;
+    BTree& operator=(const BTree&) = delete;
+
+    BTree(BTree&& other) noexcept : _root(nullptr), _size(0) {
+        swap(other);
+    }
+
+    BTree& operator=(BTree&& other) noexcept {
+        BTree(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    void swap(BTree& other) noexcept {
+        std::swap(_root, other._root);
+        std::swap(_size, other._size);
+    }
+
+    //
+    // @brief Destructeur
+    //
+    ~BTree() {
+        freeAll(_root);
+    }
+
+    //
+    // @brief taille de l'arbre
+    //
+    // @remark O(1)
+    size_t size() const noexcept {
+        return _size;
+    }
+
+    //
+    // @brief Insertion d'une cle dans l'arbre
+    //
+    // @param key la clé à insérer.
+    //
+    // Si la cle est deja presente, cette fonction ne fait rien. Sinon elle
+    // est insérée dans sa feuille ; un noeud qui déborde est scindé en deux
+    // et le séparateur remonte dans le parent, jusqu'à créer si besoin une
+    // nouvelle racine. Les noeuds nécessaires sont alloués avant toute
+    // modification.
+    //
+    // @remark O(NodeKeys * hauteur)
+    void insert(const_reference key) {
+        if (_root == nullptr) {
+            Leaf* l = new Leaf;
+            l->keys[0] = key;
+            l->count = 1;
+            _root = l;
+            _size = 1;
+            return;
+        }
+
+        Inner* path[MaxDepth];
+        size_t slot[MaxDepth];
+        size_t depth = 0;
+        Node* n = _root;
+        while (!n->leaf) {
+            size_t i = route(n, key);
+            path[depth] = inner(n);
+            slot[depth++] = i;
+            n = inner(n)->child[i];
+        }
+        size_t pos = countLess(n, n->count, key);
+        if (pos < n->count && !(key < n->keys[pos])) { // La clé est déja présente
+            return;
+        }
+
+        // un noeud plein déborde : on prépare sa moitié droite, et une
+        // nouvelle racine si tous les noeuds du chemin sont pleins
+        Node* spare[MaxDepth + 1];
+        size_t nbSpare = 0;
+        try {
+            if (n->count == NodeKeys) {
+                spare[nbSpare++] = new Leaf;
+                size_t d = depth;
+                while (d > 0 && path[d - 1]->count == NodeKeys) {
+                    spare[nbSpare++] = new Inner;
+                    --d;
+                }
+                if (d == 0) spare[nbSpare++] = new Inner;
+            }
+        } catch (...) {
+            while (nbSpare > 0) freeNode(spare[--nbSpare]);
+            throw;
+        }
+
+        insertAt(n->keys, n->count, pos, key);
+        ++n->count;
+        ++_size;
+        for (size_t d = 0; d < depth; ++d) ++path[d]->weight[slot[d]];
+
+        size_t used = 0;
+        while (n->count > NodeKeys) {
+            value_type separator;
+            Node* right = split(n, spare[used++], separator);
+            if (depth == 0) {
+                Inner* root = inner(spare[used++]);
+                root->keys[0] = separator;
+                root->child[0] = n;
+                root->child[1] = right;
+                root->weight[1] = weightOf(right);
+                root->weight[0] = _size - root->weight[1];
+                root->count = 2;
+                _root = root;
+                break;
+            }
+            Inner* parent = path[--depth];
+            size_t i = slot[depth];
+            size_t moved = weightOf(right);
+            insertAt(parent->keys, parent->count - 1, i, separator);
+            insertAt(parent->child, parent->count, i + 1, right);
+            insertAt(parent->weight, parent->count, i + 1, moved);
+            parent->weight[i] -= moved;
+            ++parent->count;
+            n = parent;
+        }
+    }
+
+private:
+    //
+    // @brief Scinde un noeud qui déborde (NodeKeys + 1 clés ou fils)
+    //
+    // @param n         le noeud à scinder, qui garde la moitié gauche
+    // @param right     noeud vide du même type, qui reçoit la moitié droite
+    // @param separator reçoit la clé à remonter dans le parent
+    //
+    // @return right
+    //
+    // @remark O(NodeKeys)
+    static Node* split(Node* n, Node* right, value_type& separator) {
+        const size_t keep = NodeKeys / 2 + 1;
+        const size_t total = n->count;
+        if (n->leaf) {
+            std::copy(n->keys + keep, n->keys + total, right->keys);
+            separator = n->keys[keep - 1];
+            leaf(right)->next = leaf(n)->next;
+            leaf(n)->next = leaf(right);
+        } else {
+            // keys[keep - 1] sépare les deux moitiés et remonte
+            std::copy(n->keys + keep, n->keys + total - 1, right->keys);
+            separator = n->keys[keep - 1];
+            std::copy(inner(n)->child + keep, inner(n)->child + total,
+                      inner(right)->child);
+            std::copy(inner(n)->weight + keep, inner(n)->weight + total,
+                      inner(right)->weight);
+        }
+        right->count = total - keep;
+        n->count = keep;
+        return right;
+    }
+
+public:
+    //
+    // @brief Recherche d'une cle.
+    //
+    // @param key la cle a rechercher
+    //
+    // @return vrai si la cle trouvee, faux sinon.
+    //
+    // @remark O(NodeKeys * hauteur), la recherche dans un noeud étant
+    //         vectorisée pour les types arithmétiques courants
+    bool contains(const_reference key) const {
+        if (_root == nullptr) return false;
+        Node* n = _root;
+        while (!n->leaf) n = inner(n)->child[route(n, key)];
+        size_t pos = countLess(n, n->count, key);
+        return pos < n->count && !(key < n->keys[pos]);
+    }
+
+    //
+    // @brief Supprime l'element de cle key de l'arbre.
+    //
+    // @param key l'element a supprimer
+    //
+    // si l'element n'est pas present, la fonction ne modifie pas
+    // l'arbre mais retourne false. Si l'element est present, elle
+    // retourne vrai
+    //
+    // Un noeud qui passe sous la moitié de sa capacité emprunte une clé
+    // (ou un fils) à un frère, ou fusionne avec lui si le frère est lui-même
+    // à moitié plein ; la fusion retire un fils du parent, qui est corrigé à
+    // son tour.
+    //
+    // @remark O(NodeKeys * hauteur)
+    bool deleteElement(const_reference key) {
+        if (_root == nullptr) return false;
+
+        Inner* path[MaxDepth];
+        size_t slot[MaxDepth];
+        size_t depth = 0;
+        Node* n = _root;
+        while (!n->leaf) {
+            size_t i = route(n, key);
+            path[depth] = inner(n);
+            slot[depth++] = i;
+            n = inner(n)->child[i];
+        }
+        size_t pos = countLess(n, n->count, key);
+        if (pos == n->count || key < n->keys[pos]) { // rien a supprimer
+            return false;
+        }
+
+        eraseAt(n->keys, n->count, pos);
+        --n->count;
+        --_size;
+        for (size_t d = 0; d < depth; ++d) --path[d]->weight[slot[d]];
+
+        while (depth > 0 && n->count < MinKeys) {
+            Inner* parent = path[--depth];
+            refill(parent, slot[depth]);
+            n = parent;
+        }
+
+        if (_root->count == 0) { // dernière clé supprimée
+            freeNode(_root);
+            _root = nullptr;
+        } else if (!_root->leaf && _root->count == 1) {
+            Node* old = _root;
+            _root = inner(old)->child[0];
+            freeNode(old);
+        }
+        return true;
+    }
+
+private:
+    //
+    // @brief Complète le fils i d'un noeud interne, tombé sous MinKeys, à
+    //        l'aide de son frère gauche (ou droit s'il n'en a pas)
+    //
+    // @remark O(NodeKeys)
+    void refill(Inner* parent, size_t i) {
+        if (i > 0) {
+            if (parent->child[i - 1]->count > MinKeys) {
+                borrowLeft(parent, i);
+            } else {
+                merge(parent, i - 1);
+            }
+        } else {
+            if (parent->child[1]->count > MinKeys) {
+                borrowRight(parent, 0);
+            } else {
+                merge(parent, 0);
+            }
+        }
+    }
+
+    //
+    // @brief Déplace la dernière clé (ou le dernier fils) du frère gauche
+    //        en tête du fils i
+    //
+    static void borrowLeft(Inner* parent, size_t i) {
+        Node* l = parent->child[i - 1];
+        Node* n = parent->child[i];
+        size_t moved = 1;
+        if (n->leaf) {
+            insertAt(n->keys, n->count, 0, l->keys[l->count - 1]);
+            parent->keys[i - 1] = l->keys[l->count - 2];
+        } else {
+            moved = inner(l)->weight[l->count - 1];
+            insertAt(n->keys, n->count - 1, 0, parent->keys[i - 1]);
+            insertAt(inner(n)->child, n->count, 0, inner(l)->child[l->count - 1]);
+            insertAt(inner(n)->weight, n->count, 0, moved);
+            parent->keys[i - 1] = l->keys[l->count - 2];
+        }
+        --l->count;
+        ++n->count;
+        parent->weight[i - 1] -= moved;
+        parent->weight[i] += moved;
+    }
+
+    //
+    // @brief Déplace la première clé (ou le premier fils) du frère droit
+    //        en queue du fils i
+    //
+    static void borrowRight(Inner* parent, size_t i) {
+        Node* n = parent->child[i];
+        Node* r = parent->child[i + 1];
+        size_t moved = 1;
+        if (n->leaf) {
+            n->keys[n->count] = r->keys[0];
+            parent->keys[i] = r->keys[0];
+            eraseAt(r->keys, r->count, 0);
+        } else {
+            moved = inner(r)->weight[0];
+            n->keys[n->count - 1] = parent->keys[i];
+            inner(n)->child[n->count] = inner(r)->child[0];
+            inner(n)->weight[n->count] = moved;
+            parent->keys[i] = r->keys[0];
+            eraseAt(r->keys, r->count - 1, 0);
+            eraseAt(inner(r)->child, r->count, 0);
+            eraseAt(inner(r)->weight, r->count, 0);
+        }
+        ++n->count;
+        --r->count;
+        parent->weight[i] += moved;
+        parent->weight[i + 1] -= moved;
+    }
+
+    //
+    // @brief Fusionne les fils i et i + 1 d'un noeud interne dans le fils i
+    //        et libère le fils i + 1
+    //
+    static void merge(Inner* parent, size_t i) {
+        Node* l = parent->child[i];
+        Node* r = parent->child[i + 1];
+        if (l->leaf) {
+            std::copy(r->keys, r->keys + r->count, l->keys + l->count);
+            leaf(l)->next = leaf(r)->next;
+        } else {
+            l->keys[l->count - 1] = parent->keys[i];
+            std::copy(r->keys, r->keys + r->count - 1, l->keys + l->count);
+            std::copy(inner(r)->child, inner(r)->child + r->count,
+                      inner(l)->child + l->count);
+            std::copy(inner(r)->weight, inner(r)->weight + r->count,
+                      inner(l)->weight + l->count);
+        }
+        l->count += r->count;
+        parent->weight[i] += parent->weight[i + 1];
+        eraseAt(parent->keys, parent->count - 1, i);
+        eraseAt(parent->child, parent->count, i + 1);
+        eraseAt(parent->weight, parent->count, i + 1);
+        --parent->count;
+        freeNode(r);
+    }
+
+public:
+    //
+    // @brief cle en position n
+    //
+    // @return une reference a la cle en position n par ordre croissant des
+    // elements
+    //
+    // @exception std::logic_error si n >= size()
+    //
+    // @remark O(NodeKeys * hauteur)
+    const_reference nth_element(size_t n) const {
+        if (n >= size())
+            throw std::logic_error("La position est plus "
+                                   "grand que le nombre "
+                                   "d'éléments");
+        Node* r = _root;
+        while (!r->leaf) {
+            size_t i = 0;
+            while (n >= inner(r)->weight[i]) n -= inner(r)->weight[i++];
+            r = inner(r)->child[i];
+        }
+        return r->keys[n];
+    }
+
+    //
+    // @brief position d'une cle dans l'ordre croissant des elements de l'arbre
+    //
+    // @param key la cle dont on cherche le rang
+    //
+    // @return la position entre 0 et size()-1, size_t(-1) si la cle est absente
+    //
+    // @remark O(NodeKeys * hauteur)
+    size_t rank(const_reference key) const {
+        size_t before = 0;
+        Node* n = descend(key, before);
+        if (n == nullptr) return size_t(-1);
+        size_t pos = countLess(n, n->count, key);
+        if (pos == n->count || key < n->keys[pos]) return size_t(-1); // Key not found
+        return before + pos;
+    }
+
+    //
+    // @brief nombre de cles strictement plus petites que key, que key soit
+    //        présente ou non
+    //
+    // @return une valeur entre 0 et size()
+    //
+    // @remark O(NodeKeys * hauteur)
+    size_t rank_lower(const_reference key) const {
+        size_t before = 0;
+        Node* n = descend(key, before);
+        return n == nullptr ? 0 : before + countLess(n, n->count, key);
+    }
+
+private:
+    //
+    // @brief feuille pouvant contenir key
+    //
+    // @param before reçoit le nombre de clés des feuilles précédentes
+    //
+    // @return la feuille, nullptr si l'arbre est vide
+    Node* descend(const_reference key, size_t& before) const {
+        Node* n = _root;
+        if (n == nullptr) return nullptr;
+        while (!n->leaf) {
+            size_t i = route(n, key);
+            for (size_t j = 0; j < i; ++j) before += inner(n)->weight[j];
+            n = inner(n)->child[i];
+        }
+        return n;
+    }
+
+public:
+    //
+    // @brief Parcours symétrique de l'arbre
+    //
+    // @param f une fonction capable d'être appelée en recevant une cle
+    //          en parametre.
+    //
+    // Le parcours suit le chaînage des feuilles.
+    //
+    // @remark O(n)
+    template<typename Fn>
+    void visitSym(Fn f) {
+        if (_root == nullptr) return;
+        Node* n = _root;
+        while (!n->leaf) n = inner(n)->child[0];
+        for (Leaf* l = leaf(n); l != nullptr; l = l->next) {
+            for (size_t i = 0; i < l->count; ++i) f(l->keys[i]);
+        }
+    }
+};
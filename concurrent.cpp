@@ -0,0 +1,541 @@
+//
+//  Concurrent Binary Search Tree
+//
+//  Arbre binaire de recherche partagé entre threads : lectures sans verrou,
+//  écritures verrouillant seulement les noeuds qu'elles modifient.
+//
+
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <stdexcept>
+
+#include "epoch.cpp"
+
+using namespace std;
+
+/**
+ *  @brief Arbre binaire de recherche concurrent
+ *
+ *  Chaque noeud compte les clés présentes dans son sous-arbre gauche
+ *  (leftSize) et porte deux verrous à version : l'un protège ses liens et
+ *  son état, l'autre leftSize. Une écriture descend sans verrou en notant
+ *  la version des liens de chaque noeud traversé, puis verrouille de haut
+ *  en bas les seuls noeuds qu'elle modifie : leftSize des ancêtres où elle
+ *  est partie à gauche, liens du noeud où elle accroche ou détache. Si les
+ *  liens d'un de ces noeuds ont changé depuis la descente, elle relâche
+ *  tout et recommence. Deux écritures sur des chemins disjoints ne se
+ *  gênent donc pas.
+ *
+ *  Une clé ne change jamais de noeud : supprimer un noeud à deux fils le
+ *  marque seulement comme supprimé (noeud de routage), et seul un noeud
+ *  avec au plus un fils est détaché, remplacé par ce fils. contains peut
+ *  ainsi descendre sans validation : un noeud détaché reste lisible (il est
+ *  libéré par EpochDomain une fois tous les lecteurs partis) et marqué
+ *  Removed, ce qui fait recommencer le lecteur qui s'y arrête.
+ *
+ *  rank et nth_element lisent les compteurs de plusieurs noeuds, qui doivent
+ *  être cohérents entre eux : ils notent la version de chaque verrou dont
+ *  ils lisent les champs, et valident à la fin qu'aucune n'a changé. Une
+ *  écriture ne les fait recommencer que si elle a modifié l'un de ces
+ *  champs : un noeud de leur chemin, ou le leftSize d'un noeud où ils
+ *  tournent à droite (rank) ou qu'ils traversent (nth_element).
+ *
+ *  L'arbre n'est pas rééquilibré.
+ *
+ *  @tparam T type des clés
+ */
+template<typename T>
+class ConcurrentBinarySearchTree {
+public:
+
+    using value_type = T;
+    using const_reference = const T&;
+
+private:
+    enum State : uint8_t {
+        Live,    // clé présente
+        Deleted, // clé supprimée, noeud de routage à deux fils
+        Removed  // noeud détaché de l'arbre
+    };
+
+    /**
+     *  @brief Verrou à version (seqlock) : pair au repos, impair pendant une
+     *  écriture. Un lecteur note une version paire, lit les champs protégés,
+     *  puis valide que la version n'a pas changé.
+     */
+    struct VersionLock {
+        std::atomic<uint64_t> version{0};
+
+        //
+        // @brief version paire courante, attendue si une écriture est en cours
+        //
+        uint64_t stable() const noexcept {
+            for (;;) {
+                uint64_t v = version.load(std::memory_order_acquire);
+                if (!(v & 1)) return v;
+                std::this_thread::yield();
+            }
+        }
+
+        //
+        // @brief verrouille si la version vaut encore seen
+        //
+        bool tryLock(uint64_t seen) noexcept {
+            if (!version.compare_exchange_strong(seen, seen + 1,
+                                                 std::memory_order_acquire)) {
+                return false;
+            }
+            std::atomic_thread_fence(std::memory_order_release);
+            return true;
+        }
+
+        void lock() noexcept {
+            while (!tryLock(stable())) {}
+        }
+
+        void unlock() noexcept {
+            version.store(version.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_release);
+        }
+    };
+
+    struct Node;
+
+    /**
+     *  @brief Liens d'un noeud, ou de la tête de l'arbre dont le fils droit
+     *  est la racine
+     */
+    struct Links {
+        std::atomic<Node*> right{nullptr};
+        std::atomic<Node*> left{nullptr};
+        VersionLock shape; // liens, et état d'un noeud
+    };
+
+    /**
+     *  @brief Noeud de l'arbre. Les champs lus par les lecteurs sont
+     *  atomiques, la clé est écrite avant la publication du noeud.
+     */
+    struct Node : Links {
+        const value_type key;
+        std::atomic<State> state;
+        std::atomic<size_t> leftSize; // clés présentes dans le sous-arbre gauche
+        VersionLock counter;          // leftSize
+
+        explicit Node(const_reference key) : key(key), state(Live), leftSize(0) {}
+    };
+
+    /**
+     *  @brief Noeud traversé par une écriture : version de ses liens lue
+     *  avant de les suivre, et direction prise
+     */
+    struct Step {
+        Links* at;
+        uint64_t seen;
+        bool left;
+    };
+
+    /**
+     *  @brief Version d'un verrou notée par un lecteur
+     */
+    struct Stamp {
+        const VersionLock* lock;
+        uint64_t version;
+    };
+
+    Links _head;
+
+    std::atomic<size_t> _size;
+
+    mutable EpochDomain<> _epoch;
+
+    static void freeNode(void* n) {
+        delete static_cast<Node*>(n);
+    }
+
+public:
+    //
+    // @brief Constructeur par défaut. Construit un arbre vide
+    //
+    ConcurrentBinarySearchTree() : _size(0) {}
+
+    ConcurrentBinarySearchTree(const ConcurrentBinarySearchTree&) = delete;
+    ConcurrentBinarySearchTree& operator=(const ConcurrentBinarySearchTree&) = delete;
+
+    //
+    // @brief Destructeur. Aucun autre thread ne doit utiliser l'arbre.
+    //
+    // Même principe que BinarySearchTree::deleteSubTree : les fils gauches
+    // sont remontés par rotation, sans pile ni récursion.
+    //
+    // @remark O(n)
+    ~ConcurrentBinarySearchTree() {
+        Node* r = _head.right.load(std::memory_order_relaxed);
+        while (r != nullptr) {
+            Node* l = r->left.load(std::memory_order_relaxed);
+            if (l != nullptr) {
+                r->left.store(l->right.load(std::memory_order_relaxed),
+                              std::memory_order_relaxed);
+                l->right.store(r, std::memory_order_relaxed);
+                r = l;
+            } else {
+                Node* next = r->right.load(std::memory_order_relaxed);
+                delete r;
+                r = next;
+            }
+        }
+    }
+
+    //
+    // @brief nombre de clés de l'arbre
+    //
+    // @remark O(1)
+    size_t size() const noexcept {
+        return _size.load(std::memory_order_relaxed);
+    }
+
+    //
+    // @brief Insertion d'une cle dans l'arbre
+    //
+    // @param key la clé à insérer.
+    //
+    // Si la cle est deja presente, cette fonction ne fait rien. Une clé
+    // supprimée dont le noeud sert encore au routage est simplement
+    // ranimée ; sinon la nouvelle feuille est publiée par une seule
+    // écriture atomique du lien.
+    //
+    // @remark O(hauteur), ne bloque que les écritures qui modifient les
+    //         mêmes noeuds
+    void insert(const_reference key) {
+        auto guard = _epoch.pin();
+        std::unique_ptr<Node> fresh; // créé au besoin, hors verrou
+        std::vector<Step> path;
+        for (;; std::this_thread::yield()) {
+            Node* z = descend(key, path);
+            const size_t last = path.size() - 1;
+            if (z != nullptr) { // La clé est déja présente, ou à ranimer
+                State s = z->state.load(std::memory_order_acquire);
+                if (s == Live) return;
+                if (s == Removed || !lockPath(path, last)) continue;
+                z->state.store(Live, std::memory_order_release);
+            } else {
+                if (!fresh) fresh.reset(new Node(key));
+                if (!lockPath(path, last)) continue;
+                Links* p = path[last].at;
+                (path[last].left ? p->left : p->right).store(fresh.release(),
+                                                             std::memory_order_release);
+            }
+            addToCounts(path, 1);
+            unlockPath(path, last);
+            return;
+        }
+    }
+
+    //
+    // @brief Supprime l'element de cle key de l'arbre.
+    //
+    // @param key l'element a supprimer
+    //
+    // @return vrai si l'élément était présent
+    //
+    // Le noeud est marqué supprimé. S'il a au plus un fils, il est détaché,
+    // ainsi que son parent si celui-ci était un noeud de routage qui n'a
+    // plus qu'un fils.
+    //
+    // @remark O(hauteur), ne bloque que les écritures qui modifient les
+    //         mêmes noeuds
+    bool deleteElement(const_reference key) {
+        auto guard = _epoch.pin();
+        std::vector<Step> path;
+        for (;; std::this_thread::yield()) {
+            Node* z = descend(key, path);
+            const size_t last = path.size() - 1;
+            if (z == nullptr) { // rien a supprimer, sauf si la descente s'est
+                // arrêtée sur un noeud détaché
+                if (last != 0 && asNode(path[last].at)->state.load() == Removed) continue;
+                return false;
+            }
+            State s = z->state.load(std::memory_order_acquire);
+            if (s == Deleted) return false;
+            if (s == Removed) continue;
+
+            // z, puis son parent devenu routage à un seul fils
+            Node* l = z->left.load(std::memory_order_acquire);
+            Node* r = z->right.load(std::memory_order_acquire);
+            const bool detachZ = l == nullptr || r == nullptr;
+            Node* child = l != nullptr ? l : r;
+            bool detachParent = false;
+            if (detachZ && last >= 2) {
+                Node* p = asNode(path[last - 1].at);
+                Node* other = (path[last - 1].left ? p->right : p->left).load();
+                detachParent = other == nullptr && p->state.load() == Deleted;
+            }
+            const size_t shapeFrom = last - size_t(detachZ) - size_t(detachParent);
+            if (!lockPath(path, shapeFrom)) continue;
+
+            z->state.store(Deleted, std::memory_order_release);
+            addToCounts(path, size_t(-1));
+            Node* detached[2];
+            size_t nbDetached = 0;
+            for (size_t i = last; i > shapeFrom; --i) {
+                Node* n = asNode(path[i].at);
+                n->state.store(Removed); // avant que le noeud devienne inaccessible
+                Links* p = path[i - 1].at;
+                (path[i - 1].left ? p->left : p->right).store(child,
+                                                              std::memory_order_release);
+                detached[nbDetached++] = n;
+            }
+            unlockPath(path, shapeFrom);
+            for (size_t i = 0; i < nbDetached; ++i) _epoch.retire(detached[i], freeNode);
+            return true;
+        }
+    }
+
+private:
+    static Node* asNode(Links* l) noexcept {
+        return static_cast<Node*>(l);
+    }
+
+    //
+    // @brief Descend sans verrou vers key
+    //
+    // @param path rempli des noeuds traversés, de la tête au dernier noeud,
+    //             avec la version de leurs liens
+    //
+    // @return le noeud de clé key, dernier de path ; nullptr si la descente
+    //         s'arrête sur un lien nul, celui du dernier noeud de path
+    Node* descend(const_reference key, std::vector<Step>& path) {
+        path.clear();
+        Links* at = &_head;
+        for (;;) {
+            uint64_t seen = at->shape.stable();
+            Node* next;
+            bool left = false;
+            if (at == &_head) {
+                next = at->right.load(std::memory_order_acquire);
+            } else {
+                Node* n = asNode(at);
+                if (key < n->key) {
+                    next = n->left.load(std::memory_order_acquire);
+                    left = true;
+                } else if (key > n->key) {
+                    next = n->right.load(std::memory_order_acquire);
+                } else {
+                    path.push_back({at, seen, false});
+                    return n;
+                }
+            }
+            path.push_back({at, seen, left});
+            if (next == nullptr) return nullptr;
+            at = next;
+        }
+    }
+
+    //
+    // @brief Verrouille, de haut en bas, le leftSize des noeuds où path
+    //        part à gauche, puis les liens de path[shapeFrom] et des noeuds
+    //        suivants
+    //
+    // Les liens ne sont verrouillés que s'ils n'ont pas changé depuis la
+    // descente, et si le noeud n'a pas été détaché entre-temps.
+    //
+    // @return faux si un lien a changé : rien ne reste verrouillé
+    bool lockPath(const std::vector<Step>& path, size_t shapeFrom) noexcept {
+        for (size_t i = 0; i < path.size(); ++i) {
+            const Step& s = path[i];
+            if (s.left) asNode(s.at)->counter.lock();
+            if (i < shapeFrom) continue;
+            if (!s.at->shape.tryLock(s.seen)) {
+                if (s.left) asNode(s.at)->counter.unlock();
+                unlockPath(path, shapeFrom, i);
+                return false;
+            }
+            if (i != 0 && asNode(s.at)->state.load(std::memory_order_relaxed) == Removed) {
+                unlockPath(path, shapeFrom, i + 1);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //
+    // @brief Relâche les verrous pris par lockPath sur les end premiers
+    //        noeuds de path
+    //
+    static void unlockPath(const std::vector<Step>& path, size_t shapeFrom,
+                           size_t end = size_t(-1)) noexcept {
+        end = std::min(end, path.size());
+        for (size_t i = 0; i < end; ++i) {
+            if (i >= shapeFrom) path[i].at->shape.unlock();
+            if (path[i].left) asNode(path[i].at)->counter.unlock();
+        }
+    }
+
+    //
+    // @brief ajoute delta (1 ou size_t(-1)) au leftSize des noeuds où path
+    //        part à gauche, et à la taille
+    //
+    void addToCounts(const std::vector<Step>& path, size_t delta) noexcept {
+        for (const Step& s : path) {
+            if (!s.left) continue;
+            std::atomic<size_t>& c = asNode(s.at)->leftSize;
+            c.store(c.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+        }
+        _size.fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    //
+    // @brief tampon des versions notées par le thread courant
+    //
+    static std::vector<Stamp>& stamps() {
+        thread_local std::vector<Stamp> buffer;
+        return buffer;
+    }
+
+    //
+    // @brief vrai si aucun des verrous notés n'a changé de version : les
+    //        champs lus étaient tous à leur valeur au même instant
+    //
+    static bool validate(const std::vector<Stamp>& seen) noexcept {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        for (const Stamp& s : seen) {
+            if (s.lock->version.load(std::memory_order_relaxed) != s.version) return false;
+        }
+        return true;
+    }
+
+    //
+    // @brief note la version paire de lock
+    //
+    static void stamp(std::vector<Stamp>& seen, const VersionLock& lock) {
+        seen.push_back({&lock, lock.stable()});
+    }
+
+public:
+    //
+    // @brief Recherche d'une cle.
+    //
+    // @param key la cle a rechercher
+    //
+    // @return vrai si la cle trouvee, faux sinon.
+    //
+    // Un lecteur qui s'arrête sur un noeud détaché recommence depuis la
+    // racine : tant qu'un noeud n'est pas détaché, il est accessible et
+    // son sous-arbre contient toutes les clés de son intervalle.
+    //
+    // @remark O(hauteur), sans verrou
+    bool contains(const_reference key) const {
+        auto guard = _epoch.pin();
+        for (;;) {
+            Node* r = _head.right.load(std::memory_order_acquire);
+            if (r == nullptr) return false;
+            for (;;) {
+                Node* next;
+                if (key < r->key) {
+                    next = r->left.load(std::memory_order_acquire);
+                } else if (key > r->key) {
+                    next = r->right.load(std::memory_order_acquire);
+                } else {
+                    State s = r->state.load(std::memory_order_acquire);
+                    if (s == Removed) break;
+                    return s == Live;
+                }
+                if (next == nullptr) {
+                    if (r->state.load(std::memory_order_acquire) == Removed) break;
+                    return false;
+                }
+                r = next;
+            }
+        }
+    }
+
+    //
+    // @brief position d'une cle dans l'ordre croissant des elements de l'arbre
+    //
+    // @param key la cle dont on cherche le rang
+    //
+    // @return la position entre 0 et size()-1, size_t(-1) si la cle est absente
+    //
+    // Valide les liens des noeuds du chemin, et leftSize là où il tourne à
+    // droite.
+    //
+    // @remark O(hauteur), sans verrou
+    size_t rank(const_reference key) const {
+        auto guard = _epoch.pin();
+        std::vector<Stamp>& seen = stamps();
+        for (;;) {
+            seen.clear();
+            stamp(seen, _head.shape);
+            size_t before = 0;
+            size_t result = size_t(-1); // Key not found
+            Node* r = _head.right.load(std::memory_order_acquire);
+            while (r != nullptr) {
+                stamp(seen, r->shape);
+                if (key < r->key) {
+                    r = r->left.load(std::memory_order_acquire);
+                    continue;
+                }
+                bool live = r->state.load(std::memory_order_acquire) == Live;
+                bool found = !(key > r->key);
+                if (found && !live) break;
+                stamp(seen, r->counter);
+                size_t l = r->leftSize.load(std::memory_order_relaxed);
+                if (found) { // Key found
+                    result = before + l;
+                    break;
+                }
+                before += l + size_t(live);
+                r = r->right.load(std::memory_order_acquire);
+            }
+            if (validate(seen)) return result;
+        }
+    }
+
+    //
+    // @brief cle en position n
+    //
+    // @return une copie de la cle en position n par ordre croissant des
+    //         elements : le noeud peut être libéré une fois la lecture finie
+    //
+    // Valide les liens et leftSize des noeuds du chemin.
+    //
+    // @exception std::logic_error si n >= size()
+    //
+    // @remark O(hauteur), sans verrou
+    value_type nth_element(size_t n) const {
+        auto guard = _epoch.pin();
+        std::vector<Stamp>& seen = stamps();
+        const Node* found;
+        do {
+            seen.clear();
+            found = nullptr;
+            size_t i = n;
+            stamp(seen, _head.shape);
+            Node* r = _head.right.load(std::memory_order_acquire);
+            while (r != nullptr) {
+                stamp(seen, r->shape);
+                stamp(seen, r->counter);
+                size_t s = r->leftSize.load(std::memory_order_relaxed);
+                size_t self = r->state.load(std::memory_order_acquire) == Live;
+                if (i < s) {
+                    r = r->left.load(std::memory_order_acquire);
+                } else if (i < s + self) { //Found
+                    found = r;
+                    break;
+                } else {
+                    i -= s + self;
+                    r = r->right.load(std::memory_order_acquire);
+                }
+            }
+        } while (!validate(seen));
+        if (found == nullptr)
+            throw std::logic_error("La position est plus "
+                                   "grand que le nombre "
+                                   "d'éléments");
+        return found->key;
+    }
+};
@@ -0,0 +1,204 @@
+//
+//  Epoch-based reclamation
+//
+//  Libération différée des noeuds retirés d'une structure lue sans verrou.
+//
+
+#ifndef EPOCH_CPP
+#define EPOCH_CPP
+
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <vector>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ *  @brief Numéro de slot du thread courant, entre 0 et MaxThreads - 1.
+ *
+ *  Le numéro est attribué au premier appel et rendu quand le thread se
+ *  termine, pour être réutilisé par un autre thread.
+ *
+ *  @exception std::logic_error si plus de MaxThreads threads vivent en
+ *             même temps
+ */
+template<size_t MaxThreads>
+size_t epochThreadSlot() {
+    static std::atomic<bool> used[MaxThreads] = {};
+
+    struct Slot {
+        size_t id;
+
+        Slot() : id(MaxThreads) {
+            for (size_t i = 0; i < MaxThreads; ++i) {
+                bool expected = false;
+                if (!used[i].load(std::memory_order_relaxed) &&
+                    used[i].compare_exchange_strong(expected, true)) {
+                    id = i;
+                    return;
+                }
+            }
+            throw std::logic_error("Trop de threads pour le domaine d'époques");
+        }
+
+        ~Slot() {
+            used[id].store(false);
+        }
+    };
+
+    thread_local Slot slot;
+    return slot.id;
+}
+
+/**
+ *  @brief Domaine de récupération mémoire par époques.
+ *
+ *  Un lecteur épingle (pin) l'époque globale le temps de son parcours. Un
+ *  noeud retiré de la structure est confié à retire() avec l'époque
+ *  courante, et n'est libéré que lorsque l'époque globale a avancé de deux :
+ *  tous les lecteurs qui pouvaient encore le voir ont alors terminé.
+ *  L'époque n'avance que si tous les threads épinglés ont vu la valeur
+ *  courante.
+ *
+ *  Chaque thread a son slot (époque épinglée et liste de noeuds retirés),
+ *  sur sa propre ligne de cache : pin() et retire() n'écrivent que dans le
+ *  slot du thread appelant.
+ *
+ *  @tparam MaxThreads nombre maximal de threads utilisant le domaine en
+ *                     même temps
+ */
+template<size_t MaxThreads = 128>
+class EpochDomain {
+public:
+    using Deleter = void (*)(void*);
+
+    /**
+     *  @brief Epinglage RAII de l'époque courante. Les épinglages d'un même
+     *  thread peuvent s'imbriquer.
+     */
+    class Guard {
+    public:
+        explicit Guard(EpochDomain& domain) : _domain(domain),
+                                              _slot(epochThreadSlot<MaxThreads>()) {
+            _domain.enter(_slot);
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        ~Guard() {
+            _domain.leave(_slot);
+        }
+
+    private:
+        EpochDomain& _domain;
+        size_t _slot;
+    };
+
+    EpochDomain() : _epoch(1) {}
+
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    //
+    // @brief Libère tous les noeuds retirés. Aucun thread ne doit plus
+    //        utiliser le domaine.
+    //
+    ~EpochDomain() {
+        for (Slot& s : _slots) {
+            for (const Retired& r : s.retired) r.free(r.ptr);
+        }
+    }
+
+    //
+    // @brief Epingle l'époque courante jusqu'à la destruction du Guard
+    //
+    Guard pin() {
+        return Guard(*this);
+    }
+
+    //
+    // @brief Confie un noeud retiré de la structure, libéré par free(ptr)
+    //        quand plus aucun lecteur ne peut l'atteindre
+    //
+    // @remark O(1) amorti ; tous les Threshold retraits, le thread tente
+    //         d'avancer l'époque et libère ce qui peut l'être
+    void retire(void* ptr, Deleter free) {
+        Slot& s = _slots[epochThreadSlot<MaxThreads>()];
+        s.retired.push_back(Retired{ptr, free, _epoch.load()});
+        if (s.retired.size() >= s.nextCollect) {
+            tryAdvance();
+            collect(s);
+            s.nextCollect = s.retired.size() + Threshold;
+        }
+    }
+
+private:
+    static constexpr uint64_t Idle = 0;
+    static constexpr size_t Threshold = 128;
+
+    struct Retired {
+        void* ptr;
+        Deleter free;
+        uint64_t epoch;
+    };
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{Idle}; // époque épinglée, Idle sinon
+        size_t depth = 0;                  // imbrication des Guard
+        std::vector<Retired> retired;      // noeuds en attente
+        size_t nextCollect = Threshold;    // taille déclenchant une collecte
+    };
+
+    void enter(size_t slot) noexcept {
+        Slot& s = _slots[slot];
+        if (s.depth++ == 0) {
+            s.epoch.store(_epoch.load(), std::memory_order_relaxed);
+            // l'épinglage est visible avant toute lecture de la structure
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    }
+
+    void leave(size_t slot) noexcept {
+        Slot& s = _slots[slot];
+        if (--s.depth == 0) {
+            s.epoch.store(Idle, std::memory_order_release);
+        }
+    }
+
+    //
+    // @brief avance l'époque si tous les threads épinglés ont vu sa valeur
+    //
+    void tryAdvance() noexcept {
+        uint64_t e = _epoch.load();
+        for (const Slot& s : _slots) {
+            uint64_t local = s.epoch.load();
+            if (local != Idle && local != e) return;
+        }
+        _epoch.compare_exchange_strong(e, e + 1);
+    }
+
+    //
+    // @brief libère les noeuds retirés depuis au moins deux époques
+    //
+    void collect(Slot& s) {
+        uint64_t e = _epoch.load();
+        size_t kept = 0;
+        for (const Retired& r : s.retired) {
+            if (r.epoch + 2 <= e) {
+                r.free(r.ptr);
+            } else {
+                s.retired[kept++] = r;
+            }
+        }
+        s.retired.resize(kept);
+    }
+
+    std::atomic<uint64_t> _epoch;
+    Slot _slots[MaxThreads];
+};
+
+#endif // EPOCH_CPP
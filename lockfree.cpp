@@ -0,0 +1,313 @@
+//
+//  Lock-free Binary Search Tree
+//
+//  Arbre binaire de recherche externe sans verrou (Natarajan et Mittal,
+//  "Fast Concurrent Lock-Free Binary Search Trees", PPoPP 2014).
+//
+
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+
+#include "epoch.cpp"
+
+using namespace std;
+
+/**
+ *  @brief Arbre binaire de recherche sans verrou
+ *
+ *  Arbre externe : les clés sont dans les feuilles, les noeuds internes ne
+ *  servent qu'au routage (clés < noeud à gauche, >= à droite). Une
+ *  insertion remplace une feuille par un noeud interne et deux feuilles en
+ *  un seul CAS.
+ *
+ *  Une suppression se fait en deux temps, chaque étape pouvant être
+ *  terminée par n'importe quel thread qui la rencontre :
+ *  - injection : l'arête vers la feuille est marquée (Flag) ;
+ *  - nettoyage : l'arête vers la feuille sœur est figée (Tag), puis un CAS
+ *    sur l'ancêtre remplace le parent par la sœur.
+ *  Une arête marquée ou figée ne change plus, ce qui permet de retirer
+ *  d'un coup toute une chaîne de suppressions en cours. Le thread dont le
+ *  CAS réussit confie les noeuds retirés à EpochDomain.
+ *
+ *  Trois sentinelles ∞0 < ∞1 < ∞2, plus grandes que toute clé, garantissent
+ *  que toute vraie feuille a un parent et un grand-parent.
+ *
+ *  @tparam T type des clés, constructible par défaut
+ */
+template<typename T>
+class LockFreeBinarySearchTree {
+public:
+
+    using value_type = T;
+    using const_reference = const T&;
+
+private:
+    static constexpr uintptr_t Flag = 1; // feuille en cours de suppression
+    static constexpr uintptr_t Tag = 2;  // arête figée, le parent va disparaître
+    static constexpr uintptr_t Marks = Flag | Tag;
+
+    /**
+     *  @brief Noeud interne ou feuille. Les arêtes portent les marques Flag
+     *  et Tag dans leurs bits de poids faible ; une feuille n'a pas de fils.
+     */
+    struct Node {
+        const value_type key;
+        const uint8_t infinity;          // 0 pour une vraie clé, 1 à 3 pour ∞0..∞2
+        std::atomic<uintptr_t> left;
+        std::atomic<uintptr_t> right;
+
+        Node(const_reference key, uint8_t infinity, Node* left, Node* right)
+                : key(key), infinity(infinity), left(uintptr_t(left)),
+                  right(uintptr_t(right)) {}
+    };
+
+    /**
+     *  @brief Résultat d'une descente : la feuille atteinte, son parent, et
+     *  la dernière arête non figée du chemin (ancestor -> successor)
+     */
+    struct SeekRecord {
+        Node* ancestor;
+        Node* successor;
+        Node* parent;
+        Node* leaf;
+    };
+
+    /**
+     *  @brief  Sentinelle racine ∞2
+     */
+    Node* _root;
+
+    mutable EpochDomain<> _epoch;
+
+    static Node* address(uintptr_t edge) noexcept {
+        return reinterpret_cast<Node*>(edge & ~Marks);
+    }
+
+    static void freeNode(void* n) {
+        delete static_cast<Node*>(n);
+    }
+
+    //
+    // @brief vrai si key est routée à gauche de n
+    //
+    static bool goesLeft(const_reference key, const Node* n) {
+        return n->infinity != 0 || key < n->key;
+    }
+
+    static std::atomic<uintptr_t>& childOf(Node* n, const_reference key) {
+        return goesLeft(key, n) ? n->left : n->right;
+    }
+
+    //
+    // @brief vrai si la feuille contient key
+    //
+    static bool holds(const Node* leaf, const_reference key) {
+        return leaf->infinity == 0 && !(key < leaf->key) && !(leaf->key < key);
+    }
+
+public:
+    //
+    // @brief Constructeur par défaut. Construit un arbre vide, réduit aux
+    //        sentinelles
+    //
+    LockFreeBinarySearchTree() : _root(nullptr) {
+        Node* s = new Node(value_type(), 2, nullptr, nullptr);
+        try {
+            s->left.store(uintptr_t(new Node(value_type(), 1, nullptr, nullptr)));
+            s->right.store(uintptr_t(new Node(value_type(), 2, nullptr, nullptr)));
+            _root = new Node(value_type(), 3, s, nullptr);
+            _root->right.store(uintptr_t(new Node(value_type(), 3, nullptr, nullptr)));
+        } catch (...) {
+            freeAll(_root != nullptr ? _root : s);
+            throw;
+        }
+    }
+
+    LockFreeBinarySearchTree(const LockFreeBinarySearchTree&) = delete;
+    LockFreeBinarySearchTree& operator=(const LockFreeBinarySearchTree&) = delete;
+
+    //
+    // @brief Destructeur. Aucun autre thread ne doit utiliser l'arbre.
+    //
+    // @remark O(n)
+    ~LockFreeBinarySearchTree() {
+        freeAll(_root);
+    }
+
+private:
+    //
+    // @brief libère un sous-arbre en remontant les fils gauches par
+    //        rotation, sans pile ni récursion
+    //
+    static void freeAll(Node* r) noexcept {
+        while (r != nullptr) {
+            Node* l = address(r->left.load(std::memory_order_relaxed));
+            if (l != nullptr) {
+                r->left.store(l->right.load(std::memory_order_relaxed),
+                              std::memory_order_relaxed);
+                l->right.store(uintptr_t(r), std::memory_order_relaxed);
+                r = l;
+            } else {
+                Node* next = address(r->right.load(std::memory_order_relaxed));
+                delete r;
+                r = next;
+            }
+        }
+    }
+
+    //
+    // @brief Descend jusqu'à la feuille où key est ou serait
+    //
+    // @remark O(hauteur)
+    SeekRecord seek(const_reference key) const {
+        SeekRecord s;
+        s.ancestor = _root;
+        s.successor = address(_root->left.load(std::memory_order_acquire));
+        s.parent = s.successor;
+        uintptr_t parentEdge = s.parent->left.load(std::memory_order_acquire);
+        s.leaf = address(parentEdge);
+        uintptr_t currentEdge = childOf(s.leaf, key).load(std::memory_order_acquire);
+        for (Node* current = address(currentEdge); current != nullptr;
+             current = address(currentEdge)) {
+            if (!(parentEdge & Tag)) {
+                s.ancestor = s.parent;
+                s.successor = s.leaf;
+            }
+            s.parent = s.leaf;
+            s.leaf = current;
+            parentEdge = currentEdge;
+            currentEdge = childOf(current, key).load(std::memory_order_acquire);
+        }
+        return s;
+    }
+
+    //
+    // @brief Retire du chemin de key la feuille marquée sous s.parent :
+    //        fige l'arête vers sa sœur puis remplace s.successor par la
+    //        sœur
+    //
+    // @return vrai si ce thread a fait le remplacement
+    bool cleanup(const_reference key, const SeekRecord& s) {
+        std::atomic<uintptr_t>& successorEdge = childOf(s.ancestor, key);
+        std::atomic<uintptr_t>* childEdge = &s.parent->left;
+        std::atomic<uintptr_t>* siblingEdge = &s.parent->right;
+        if (!goesLeft(key, s.parent)) std::swap(childEdge, siblingEdge);
+        if (!(childEdge->load(std::memory_order_acquire) & Flag)) {
+            // la feuille à retirer est du côté opposé à key
+            siblingEdge = childEdge;
+        }
+        siblingEdge->fetch_or(Tag);
+        uintptr_t sibling = siblingEdge->load(std::memory_order_acquire);
+        uintptr_t expected = uintptr_t(s.successor);
+        // la sœur garde sa marque Flag éventuelle, pas le Tag
+        if (!successorEdge.compare_exchange_strong(expected, sibling & ~Tag))
+            return false;
+        retireChain(key, s.successor, s.parent, address(sibling));
+        return true;
+    }
+
+    //
+    // @brief Confie à _epoch les noeuds détachés par cleanup : les noeuds
+    //        internes de successor à parent sur le chemin de key, et leurs
+    //        feuilles marquées. kept est la sœur remontée, toujours en place.
+    //
+    void retireChain(const_reference key, Node* n, Node* parent, Node* kept) {
+        for (;;) {
+            Node* l = address(n->left.load(std::memory_order_relaxed));
+            Node* r = address(n->right.load(std::memory_order_relaxed));
+            Node* next = n == parent ? kept : (goesLeft(key, n) ? l : r);
+            _epoch.retire(next == l ? r : l, freeNode);
+            _epoch.retire(n, freeNode);
+            if (n == parent) return;
+            n = next;
+        }
+    }
+
+public:
+    //
+    // @brief Insertion d'une cle dans l'arbre
+    //
+    // @param key la clé à insérer.
+    //
+    // @return vrai si la clé a été insérée, faux si elle était déjà présente
+    //
+    // La feuille atteinte est remplacée par un noeud interne ayant pour
+    // fils cette feuille et la nouvelle. Si l'arête a changé entre-temps, on
+    // aide la suppression en cours qui l'a marquée puis on recommence.
+    //
+    // @remark O(hauteur), sans verrou
+    bool insert(const_reference key) {
+        auto guard = _epoch.pin();
+        Node* fresh = new Node(key, 0, nullptr, nullptr);
+        for (;;) {
+            SeekRecord s = seek(key);
+            Node* leaf = s.leaf;
+            if (holds(leaf, key)) { // La clé est déja présente
+                delete fresh;
+                return false;
+            }
+            Node* internal;
+            try {
+                internal = leaf->infinity != 0 || key < leaf->key
+                           ? new Node(leaf->key, leaf->infinity, fresh, leaf)
+                           : new Node(key, 0, leaf, fresh);
+            } catch (...) {
+                delete fresh;
+                throw;
+            }
+            std::atomic<uintptr_t>& edge = childOf(s.parent, key);
+            uintptr_t expected = uintptr_t(leaf);
+            if (edge.compare_exchange_strong(expected, uintptr_t(internal))) return true;
+            delete internal; // jamais publié
+            if (address(expected) == leaf && (expected & Marks)) cleanup(key, s);
+        }
+    }
+
+    //
+    // @brief Recherche d'une cle.
+    //
+    // @param key la cle a rechercher
+    //
+    // @return vrai si la cle trouvee, faux sinon.
+    //
+    // @remark O(hauteur), sans verrou ni écriture partagée
+    bool contains(const_reference key) const {
+        auto guard = _epoch.pin();
+        return holds(seek(key).leaf, key);
+    }
+
+    //
+    // @brief Supprime l'element de cle key de l'arbre.
+    //
+    // @param key l'element a supprimer
+    //
+    // @return vrai si ce thread a supprimé l'élément, faux s'il était absent
+    //
+    // La suppression est acquise dès que l'arête vers la feuille est
+    // marquée ; le nettoyage est ensuite répété jusqu'à ce que la feuille
+    // ait disparu, par ce thread ou par un autre.
+    //
+    // @remark O(hauteur), sans verrou
+    bool deleteElement(const_reference key) {
+        auto guard = _epoch.pin();
+        Node* leaf = nullptr; // feuille marquée par ce thread
+        for (;;) {
+            SeekRecord s = seek(key);
+            if (leaf == nullptr) { // injection
+                if (!holds(s.leaf, key)) return false;
+                std::atomic<uintptr_t>& edge = childOf(s.parent, key);
+                uintptr_t expected = uintptr_t(s.leaf);
+                if (edge.compare_exchange_strong(expected, expected | Flag)) {
+                    leaf = s.leaf;
+                    if (cleanup(key, s)) return true;
+                } else if (address(expected) == s.leaf && (expected & Marks)) {
+                    cleanup(key, s);
+                }
+            } else { // nettoyage
+                if (s.leaf != leaf || cleanup(key, s)) return true;
+            }
+        }
+    }
+};
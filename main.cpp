@@ -11,7 +11,7 @@ void afficher(T value) {
 
 int main() {
 
-    BinarySearchTree<int> test;
+    BinarySearchTree<int, CoutTrace> test;
 
     test.insert(10);
     test.insert(12);
@@ -55,12 +55,12 @@ int main() {
 
     cout << test.nth_element(3) << endl;
 
-    BinarySearchTree<int> test2(test);
+    BinarySearchTree<int, CoutTrace> test2(test);
 
-    BinarySearchTree<int> test3;
+    BinarySearchTree<int, CoutTrace> test3;
     test3.insert(100);
 
-    BinarySearchTree<int> abr2;
+    BinarySearchTree<int, CoutTrace> abr2;
     abr2.insert(3);
     abr2.insert(7);
     abr2.insert(4);
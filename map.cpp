@@ -0,0 +1,218 @@
+//
+//  Binary Search Map
+//
+//  Dictionnaire ordonné clé -> valeur construit sur BinarySearchTree : les
+//  noeuds, le rééquilibrage et les compteurs nbElements sont ceux de
+//  l'arbre, la valeur est modifiable en place.
+//
+
+#include <cstdlib>
+#include <cstddef>
+#include <utility>
+#include <stdexcept>
+
+#include "abr.cpp"
+
+using namespace std;
+
+/**
+ *  @brief Entrée d'un BinarySearchMap : une clé et sa valeur.
+ *
+ *  Seule la clé participe aux comparaisons, entre entrées comme avec une
+ *  clé seule (voir TransparentKey) : l'arbre cherche et insère
+ *  directement par K. La valeur est mutable, donc modifiable à travers
+ *  les références constantes que donnent l'arbre et ses itérateurs.
+ */
+template<typename K, typename V>
+struct MapEntry {
+    const K key;
+    mutable V value; // ne change pas l'ordre des entrées
+
+    //
+    // @brief construit la clé à partir de key et la valeur à partir de args
+    //
+    template<typename Key, typename... Args>
+    MapEntry(std::in_place_t, Key&& key, Args&&... args)
+            : key(std::forward<Key>(key)), value(std::forward<Args>(args)...) {}
+
+    friend bool operator<(const MapEntry& a, const MapEntry& b) { return a.key < b.key; }
+    friend bool operator>(const MapEntry& a, const MapEntry& b) { return b.key < a.key; }
+    friend bool operator<(const K& k, const MapEntry& e) { return k < e.key; }
+    friend bool operator>(const K& k, const MapEntry& e) { return e.key < k; }
+    friend bool operator<(const MapEntry& e, const K& k) { return e.key < k; }
+    friend bool operator>(const MapEntry& e, const K& k) { return k < e.key; }
+};
+
+/**
+ *  @brief Dictionnaire ordonné par clé
+ *
+ *  Chaque entrée est un noeud de BinarySearchTree<MapEntry<K, V>> : les
+ *  recherches, insertions et suppressions se font par K en une seule
+ *  descente, et rank / nth_element portent sur les clés. Modifier une
+ *  valeur ne touche ni à l'arbre ni à l'allocateur.
+ *
+ *  @tparam K       type des clés
+ *  @tparam V       type des valeurs
+ *  @tparam Balance politique de rééquilibrage de l'arbre
+ *  @tparam Alloc   politique d'allocation des noeuds
+ */
+template<typename K, typename V, typename Balance = WeightBalanced,
+        typename Alloc = NewAllocator>
+class BinarySearchMap {
+public:
+
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = MapEntry<K, V>;
+    using const_iterator = typename BinarySearchTree<value_type, NoTrace, Balance,
+                                                     Alloc>::const_iterator;
+    using iterator = const_iterator; // la clé est fixe, la valeur modifiable
+
+private:
+    /**
+     *  @brief  Les entrées, ordonnées par clé
+     */
+    BinarySearchTree<value_type, NoTrace, Balance, Alloc> _tree;
+
+public:
+    //
+    // @brief taille du dictionnaire
+    //
+    // @remark O(1)
+    size_t size() const noexcept {
+        return _tree.size();
+    }
+
+    bool empty() const noexcept {
+        return _tree.size() == 0;
+    }
+
+    iterator begin() const noexcept {
+        return _tree.begin();
+    }
+
+    iterator end() const noexcept {
+        return _tree.end();
+    }
+
+    //
+    // @brief Recherche d'une clé
+    //
+    // @return un itérateur sur l'entrée, end() si la clé est absente. La
+    //         valeur se modifie en place par it->value.
+    //
+    // @remark O(hauteur)
+    iterator find(const key_type& key) const noexcept {
+        return _tree.find(key);
+    }
+
+    bool contains(const key_type& key) const noexcept {
+        return _tree.contains(key);
+    }
+
+    //
+    // @brief valeur associée à key
+    //
+    // @exception std::logic_error si la clé est absente
+    //
+    // @remark O(hauteur)
+    mapped_type& at(const key_type& key) {
+        iterator it = _tree.find(key);
+        if (it == _tree.end())
+            throw std::logic_error("La clé est absente");
+        return it->value;
+    }
+
+    const mapped_type& at(const key_type& key) const {
+        iterator it = _tree.find(key);
+        if (it == _tree.end())
+            throw std::logic_error("La clé est absente");
+        return it->value;
+    }
+
+    //
+    // @brief valeur associée à key, insérée construite par défaut si la
+    //        clé est absente
+    //
+    // @remark O(hauteur), une seule descente
+    mapped_type& operator[](const key_type& key) {
+        return _tree.try_emplace(key, std::in_place, key).first->value;
+    }
+
+    mapped_type& operator[](key_type&& key) {
+        return _tree.try_emplace(key, std::in_place, std::move(key)).first->value;
+    }
+
+    //
+    // @brief Insère key avec une valeur construite à partir de args, si la
+    //        clé est absente
+    //
+    // @return un itérateur sur l'entrée de clé key, et vrai si elle vient
+    //         d'être insérée. Si la clé était présente, args n'est pas
+    //         utilisé et sa valeur est inchangée.
+    //
+    // @remark O(hauteur), une seule descente
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args) {
+        return _tree.try_emplace(key, std::in_place, key, std::forward<Args>(args)...);
+    }
+
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args) {
+        return _tree.try_emplace(key, std::in_place, std::move(key),
+                                 std::forward<Args>(args)...);
+    }
+
+    //
+    // @brief Associe value à key : insère l'entrée si la clé est absente,
+    //        remplace sa valeur sinon
+    //
+    // @return un itérateur sur l'entrée de clé key, et vrai si elle vient
+    //         d'être insérée
+    //
+    // @remark O(hauteur), une seule descente
+    template<typename M>
+    std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& value) {
+        auto r = _tree.try_emplace(key, std::in_place, key, std::forward<M>(value));
+        if (!r.second) r.first->value = std::forward<M>(value);
+        return r;
+    }
+
+    template<typename M>
+    std::pair<iterator, bool> insert_or_assign(key_type&& key, M&& value) {
+        auto r = _tree.try_emplace(key, std::in_place, std::move(key),
+                                   std::forward<M>(value));
+        if (!r.second) r.first->value = std::forward<M>(value);
+        return r;
+    }
+
+    //
+    // @brief Supprime l'entrée de clé key
+    //
+    // @return vrai si la clé était présente
+    //
+    // @remark O(hauteur)
+    bool erase(const key_type& key) noexcept {
+        return _tree.deleteElement(key);
+    }
+
+    //
+    // @brief entrée en position n par ordre croissant des clés
+    //
+    // @exception std::logic_error si n >= size()
+    //
+    // @remark O(hauteur)
+    const value_type& nth_element(size_t n) const {
+        return _tree.nth_element(n);
+    }
+
+    //
+    // @brief position de key dans l'ordre croissant des clés
+    //
+    // @return la position entre 0 et size()-1, size_t(-1) si la clé est absente
+    //
+    // @remark O(hauteur)
+    size_t rank(const key_type& key) const noexcept {
+        return _tree.rank(key);
+    }
+};
@@ -0,0 +1,443 @@
+//
+//  Persistent Binary Search Tree
+//
+//  Arbre binaire de recherche persistant : chaque modification copie le
+//  chemin racine-feuille et partage le reste avec les versions précédentes.
+//
+
+#include <cstdlib>
+#include <cstddef>
+#include <atomic>
+#include <vector>
+#include <stdexcept>
+
+#include "abr.cpp"
+
+using namespace std;
+
+/**
+ *  @brief Arbre binaire de recherche persistant
+ *
+ *  Un noeud publié n'est plus jamais modifié : insert et deleteElement
+ *  recopient les noeuds du chemin modifié (et ceux touchés par les
+ *  rotations) et partagent tous les autres avec les versions précédentes.
+ *  Les noeuds sont libérés par comptage de références atomique.
+ *
+ *  Copier l'arbre, ou prendre un snapshot(), est donc en O(1), et chaque
+ *  version garde ses propres nbElements : rank et nth_element répondent
+ *  pour cette version. Une version peut être lue par plusieurs threads
+ *  sans verrou pendant que d'autres versions sont modifiées ; un même
+ *  objet ne doit pas être modifié et lu en même temps.
+ *
+ *  @tparam T       type des clés
+ *  @tparam Balance politique de rééquilibrage appliquée aux chemins
+ *                  recopiés (WeightBalanced, NoBalance)
+ */
+template<typename T, typename Balance = WeightBalanced>
+class PersistentBinarySearchTree {
+    static_assert(!Balance::rebuilds,
+                  "les chemins recopiés ne se rééquilibrent que par rotations");
+
+public:
+
+    using value_type = T;
+    using reference = T&;
+    using const_reference = const T&;
+
+private:
+    /**
+     *  @brief Noeud partagé entre versions. Ses champs ne changent plus
+     *  dès qu'une autre référence que celle de son créateur existe.
+     */
+    struct Node {
+        const value_type key;
+        Node* right;
+        Node* left;
+        size_t nbElements;
+        std::atomic<size_t> refs; // parents et versions qui le référencent
+
+        explicit Node(const_reference key)
+                : key(key), right(nullptr), left(nullptr), nbElements(1),
+                  refs(1) {}
+    };
+
+    /**
+     *  @brief un pas de descente : le noeud et le côté emprunté
+     */
+    struct Step {
+        Node* node;
+        bool left;
+    };
+
+    /**
+     *  @brief  Racine de cette version. nullptr si l'arbre est vide
+     */
+    Node* _root;
+
+    /**
+     *  @brief  Politique de rééquilibrage
+     */
+    Balance _balance;
+
+    static size_t sizeOf(const Node* r) noexcept {
+        return r == nullptr ? 0 : r->nbElements;
+    }
+
+    static void update(Node* r) noexcept {
+        r->nbElements = 1 + sizeOf(r->left) + sizeOf(r->right);
+    }
+
+    static Node* retain(Node* r) noexcept {
+        if (r != nullptr) r->refs.fetch_add(1, std::memory_order_relaxed);
+        return r;
+    }
+
+    //
+    // @brief Rend une référence. Un noeud qui n'est plus référencé est
+    //        libéré, ses fils rendus à leur tour.
+    //
+    // Les noeuds libérés servent eux-mêmes de pile : left chaîne la pile,
+    // right garde le fils droit en attente.
+    //
+    // @remark O(nombre de noeuds libérés), sans pile ni récursion
+    static void release(Node* n) noexcept {
+        Node* stack = nullptr;
+        for (;;) {
+            if (n != nullptr &&
+                n->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                Node* l = n->left;
+                n->left = stack;
+                stack = n;
+                n = l;
+            } else if (stack != nullptr) {
+                Node* frame = stack;
+                stack = frame->left;
+                n = frame->right;
+                delete frame;
+            } else {
+                return;
+            }
+        }
+    }
+
+    //
+    // @brief Rend r modifiable : si r est partagé, il est remplacé par une
+    //        copie dont cet appelant est le seul propriétaire
+    //
+    // @param r une référence possédée par l'appelant, modifiée par la
+    //          fonction. Inchangée si la copie échoue.
+    //
+    // @remark O(1)
+    static void own(Node*& r) {
+        if (r->refs.load(std::memory_order_acquire) == 1) return;
+        Node* copy = new Node(r->key);
+        copy->left = retain(r->left);
+        copy->right = retain(r->right);
+        copy->nbElements = r->nbElements;
+        release(r);
+        r = copy;
+    }
+
+    //
+    // @brief rotation à gauche d'un noeud modifiable : le fils droit de r
+    //        (recopié s'il est partagé) prend sa place
+    //
+    // @remark O(1)
+    static void rotateLeft(Node*& r) {
+        own(r->right);
+        Node* x = r->right;
+        r->right = x->left;
+        x->left = r;
+        x->nbElements = r->nbElements;
+        update(r);
+        r = x;
+    }
+
+    //
+    // @brief rotation à droite d'un noeud modifiable
+    //
+    // @remark O(1)
+    static void rotateRight(Node*& r) {
+        own(r->left);
+        Node* x = r->left;
+        r->left = x->right;
+        x->right = r;
+        x->nbElements = r->nbElements;
+        update(r);
+        r = x;
+    }
+
+    //
+    // @brief corrige le déséquilibre éventuel d'un noeud modifiable selon
+    //        la politique Balance, comme BinarySearchTree::rebalance
+    //
+    // @remark O(1)
+    void rebalance(Node*& r) {
+        size_t sl = sizeOf(r->left);
+        size_t sr = sizeOf(r->right);
+        if (_balance.overweight(sr, sl)) {
+            if (!_balance.singleRotation(sizeOf(r->right->left),
+                                         sizeOf(r->right->right))) {
+                own(r->right);
+                rotateRight(r->right);
+            }
+            rotateLeft(r);
+        } else if (_balance.overweight(sl, sr)) {
+            if (!_balance.singleRotation(sizeOf(r->left->right),
+                                         sizeOf(r->left->left))) {
+                own(r->left);
+                rotateLeft(r->left);
+            }
+            rotateRight(r);
+        }
+    }
+
+    //
+    // @brief Recopie un chemin de bas en haut
+    //
+    // @param path la descente, de la racine vers le bas
+    // @param sub  nouveau sous-arbre (référence possédée) remplaçant le
+    //             fils emprunté par le dernier pas
+    //
+    // @return la nouvelle racine, référence possédée. En cas d'exception,
+    //         sub est rendu.
+    //
+    // @remark O(longueur du chemin)
+    Node* rebuild(const std::vector<Step>& path, Node* sub) {
+        try {
+            for (size_t i = path.size(); i-- > 0;) {
+                const Step& s = path[i];
+                Node* n = new Node(s.node->key);
+                n->left = s.left ? sub : retain(s.node->left);
+                n->right = s.left ? retain(s.node->right) : sub;
+                sub = n;
+                update(sub);
+                rebalance(sub);
+            }
+        } catch (...) {
+            release(sub);
+            throw;
+        }
+        return sub;
+    }
+
+public:
+    //
+    // @brief Constructeur par défaut. Construit un arbre vide
+    //
+    PersistentBinarySearchTree() noexcept : _root(nullptr) {}
+
+    //
+    // @brief Constructeur de copie : partage la version de other
+    //
+    // @remark O(1)
+    PersistentBinarySearchTree(const PersistentBinarySearchTree& other) noexcept
+            : _root(retain(other._root)), _balance(other._balance) {}
+
+    PersistentBinarySearchTree(PersistentBinarySearchTree&& other) noexcept
+            : _root(other._root), _balance(other._balance) {
+        other._root = nullptr;
+    }
+
+    PersistentBinarySearchTree& operator=(PersistentBinarySearchTree other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    void swap(PersistentBinarySearchTree& other) noexcept {
+        std::swap(_root, other._root);
+        std::swap(_balance, other._balance);
+    }
+
+    //
+    // @brief Destructeur. Rend la version ; seuls les noeuds qu'aucune
+    //        autre version ne partage sont libérés.
+    //
+    ~PersistentBinarySearchTree() {
+        release(_root);
+    }
+
+    //
+    // @brief Version courante, figée : les modifications ultérieures de cet
+    //        arbre ne s'y reflètent pas
+    //
+    // @remark O(1)
+    PersistentBinarySearchTree snapshot() const noexcept {
+        return *this;
+    }
+
+    //
+    // @brief Insertion d'une cle dans l'arbre
+    //
+    // @param key la clé à insérer.
+    //
+    // Si la cle est deja presente, cette fonction ne fait rien. Sinon les
+    // noeuds du chemin sont recopiés au-dessus de la nouvelle feuille et
+    // rééquilibrés selon Balance. Les autres versions sont inchangées.
+    //
+    // @remark O(hauteur) en temps et en mémoire
+    void insert(const_reference key) {
+        std::vector<Step> path;
+        for (Node* r = _root; r != nullptr;) {
+            if (key < r->key) {
+                path.push_back({r, true});
+                r = r->left;
+            } else if (key > r->key) {
+                path.push_back({r, false});
+                r = r->right;
+            } else { // La clé est déja présente
+                return;
+            }
+        }
+        Node* root = rebuild(path, new Node(key));
+        release(_root);
+        _root = root;
+    }
+
+    //
+    // @brief Supprime l'element de cle key de l'arbre.
+    //
+    // @param key l'element a supprimer
+    //
+    // @return vrai si l'élément était présent
+    //
+    // Un noeud à deux fils est remplacé par une copie de son successeur,
+    // retiré du sous-arbre droit recopié.
+    //
+    // @remark O(hauteur) en temps et en mémoire
+    bool deleteElement(const_reference key) {
+        std::vector<Step> path;
+        Node* z = _root;
+        while (z != nullptr && (key < z->key || key > z->key)) {
+            path.push_back({z, key < z->key});
+            z = key < z->key ? z->left : z->right;
+        }
+        if (z == nullptr) { // rien a supprimer
+            return false;
+        }
+
+        Node* sub;
+        if (z->left == nullptr || z->right == nullptr) {
+            sub = retain(z->left != nullptr ? z->left : z->right);
+        } else {
+            std::vector<Step> minPath;
+            Node* m = z->right;
+            for (; m->left != nullptr; m = m->left) minPath.push_back({m, true});
+            Node* right = rebuild(minPath, retain(m->right));
+            try {
+                sub = new Node(m->key);
+            } catch (...) {
+                release(right);
+                throw;
+            }
+            sub->left = retain(z->left);
+            sub->right = right;
+            update(sub);
+            try {
+                rebalance(sub);
+            } catch (...) {
+                release(sub);
+                throw;
+            }
+        }
+        Node* root = rebuild(path, sub);
+        release(_root);
+        _root = root;
+        return true;
+    }
+
+    //
+    // @brief taille de l'arbre
+    //
+    // @remark O(1)
+    size_t size() const noexcept {
+        return sizeOf(_root);
+    }
+
+    //
+    // @brief Recherche d'une cle.
+    //
+    // @remark O(hauteur), sans verrou
+    bool contains(const_reference key) const noexcept {
+        for (Node* r = _root; r != nullptr;) {
+            if (key < r->key) {
+                r = r->left;
+            } else if (key > r->key) {
+                r = r->right;
+            } else {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    //
+    // @brief cle en position n dans cette version
+    //
+    // @exception std::logic_error si n >= size()
+    //
+    // @remark O(hauteur)
+    const_reference nth_element(size_t n) const {
+        if (n >= size())
+            throw std::logic_error("La position est plus "
+                                   "grand que le nombre "
+                                   "d'éléments");
+        for (Node* r = _root;;) {
+            size_t s = sizeOf(r->left);
+            if (n < s) {
+                r = r->left;
+            } else if (n > s) {
+                n -= s + 1;
+                r = r->right;
+            } else { //Found
+                return r->key;
+            }
+        }
+    }
+
+    //
+    // @brief position d'une cle dans l'ordre croissant de cette version
+    //
+    // @return la position entre 0 et size()-1, size_t(-1) si la cle est absente
+    //
+    // @remark O(hauteur)
+    size_t rank(const_reference key) const noexcept {
+        size_t before = 0;
+        for (Node* r = _root; r != nullptr;) {
+            if (key < r->key) {
+                r = r->left;
+            } else if (key > r->key) {
+                before += sizeOf(r->left) + 1;
+                r = r->right;
+            } else { // Key found
+                return before + sizeOf(r->left);
+            }
+        }
+        return size_t(-1); // Key not found
+    }
+
+    //
+    // @brief Parcours symétrique de cette version
+    //
+    // @param f une fonction capable d'être appelée en recevant une cle
+    //
+    // Les noeuds partagés n'ont pas de lien parent : le chemin est gardé
+    // sur une pile de taille O(hauteur).
+    //
+    // @remark O(n)
+    template<typename Fn>
+    void visitSym(Fn f) const {
+        std::vector<const Node*> stack;
+        for (const Node* r = _root; r != nullptr || !stack.empty();) {
+            if (r != nullptr) {
+                stack.push_back(r);
+                r = r->left;
+            } else {
+                r = stack.back();
+                stack.pop_back();
+                f(r->key);
+                r = r->right;
+            }
+        }
+    }
+};